@@ -0,0 +1,494 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "StateChunk.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#if JUCE_LINUX
+ #include <linux/perf_event.h>
+ #include <sys/ioctl.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+// Headless benchmarks for SimpleCC. Every result is printed as it finishes
+// and, with --json <file>, written out as one JSON document so runs from
+// different releases can be compared. --quick skips the largest preset
+// library and shortens the processBlock runs.
+//
+// On Linux the processBlock results also count the cache misses taken inside
+// processBlock, when perf events are available to the user (see
+// /proc/sys/kernel/perf_event_paranoid).
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+
+    using Clock = std::chrono::steady_clock;
+
+    class Report
+    {
+    public:
+        // Adds one result: the benchmark's name, what it was run with and
+        // what was measured.
+        void add(const juce::String& benchmark, juce::DynamicObject* parameters, juce::DynamicObject* metrics)
+        {
+            auto* result = new juce::DynamicObject();
+            result->setProperty("benchmark", benchmark);
+            result->setProperty("parameters", juce::var(parameters));
+            result->setProperty("metrics", juce::var(metrics));
+            results.add(juce::var(result));
+
+            std::cout << benchmark << " " << juce::JSON::toString(juce::var(parameters), true)
+                      << "\n    " << juce::JSON::toString(juce::var(metrics), true, 3) << "\n";
+        }
+
+        bool writeTo(const juce::File& file) const
+        {
+            auto* root = new juce::DynamicObject();
+            root->setProperty("version", SIMPLECC_VERSION);
+            root->setProperty("sampleRate", sampleRate);
+            root->setProperty("results", results);
+            return file.replaceWithText(juce::JSON::toString(juce::var(root)));
+        }
+
+    private:
+        juce::Array<juce::var> results;
+    };
+
+    juce::DynamicObject* makeObject(std::initializer_list<std::pair<const char*, juce::var>> properties)
+    {
+        auto* object = new juce::DynamicObject();
+
+        for (const auto& property : properties)
+            object->setProperty(property.first, property.second);
+
+        return object;
+    }
+
+    template <typename Function>
+    double nanosecondsPerCall(int iterations, Function&& function)
+    {
+        auto start = Clock::now();
+
+        for (int i = 0; i < iterations; ++i)
+            function();
+
+        std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+
+    double percentile(std::vector<double>& values, double fraction)
+    {
+        auto nth = values.begin() + (std::ptrdiff_t)((double)(values.size() - 1) * fraction);
+        std::nth_element(values.begin(), nth, values.end());
+        return *nth;
+    }
+
+    // User-space cache misses and L1 data cache read misses, counted only
+    // while enabled. Counts are 0 where perf events are unavailable.
+    class CacheMissCounter
+    {
+    public:
+        CacheMissCounter()
+        {
+           #if JUCE_LINUX
+            cacheMisses = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+            l1dMisses = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+                                                 | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                                 | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+           #endif
+        }
+
+        ~CacheMissCounter()
+        {
+           #if JUCE_LINUX
+            for (int fd : { cacheMisses, l1dMisses })
+                if (fd >= 0)
+                    close(fd);
+           #endif
+        }
+
+        bool isAvailable() const { return cacheMisses >= 0; }
+
+        void start()
+        {
+           #if JUCE_LINUX
+            for (int fd : { cacheMisses, l1dMisses })
+                if (fd >= 0)
+                    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+           #endif
+        }
+
+        void stop()
+        {
+           #if JUCE_LINUX
+            for (int fd : { cacheMisses, l1dMisses })
+                if (fd >= 0)
+                    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+           #endif
+        }
+
+        juce::int64 getCacheMisses() const { return readCounter(cacheMisses); }
+        juce::int64 getL1dMisses() const { return readCounter(l1dMisses); }
+
+    private:
+       #if JUCE_LINUX
+        static int openCounter(juce::uint32 type, juce::uint64 config)
+        {
+            perf_event_attr attributes {};
+            attributes.size = sizeof(attributes);
+            attributes.type = type;
+            attributes.config = config;
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+        }
+       #endif
+
+        static juce::int64 readCounter(int fd)
+        {
+            juce::int64 count = 0;
+
+           #if JUCE_LINUX
+            if (fd >= 0 && read(fd, &count, sizeof(count)) != (ssize_t)sizeof(count))
+                count = 0;
+           #else
+            juce::ignoreUnused(fd);
+           #endif
+
+            return count;
+        }
+
+        int cacheMisses = -1;
+        int l1dMisses = -1;
+    };
+
+    StateChunk::State makeState(int numSlots)
+    {
+        StateChunk::State state;
+        juce::Random random(numSlots);
+
+        for (int i = 0; i < numSlots; ++i)
+        {
+            StateChunk::Slot slot;
+            slot.ccNumber = random.nextInt(128);
+            slot.midiChannel = 1 + random.nextInt(16);
+            slot.enabled = random.nextBool();
+            slot.value = random.nextFloat();
+            slot.name = "Filter Env Amount " + juce::String(i + 1);
+            state.slots.push_back(slot);
+        }
+
+        state.presetManufacturer = "Arturia";
+        state.presetName = "MatrixBrute";
+        state.presetIsUser = true;
+        return state;
+    }
+
+    void runStateChunkBenchmark(Report& report, int numSlots, int iterations)
+    {
+        auto state = makeState(numSlots);
+        auto restored = state;
+
+        juce::MemoryBlock binary;
+        juce::MemoryBlock xml;
+
+        auto writeBinary = nanosecondsPerCall(iterations, [&] {
+            StateChunk::writeBinary(state, binary);
+        });
+
+        auto readBinary = nanosecondsPerCall(iterations, [&] {
+            StateChunk::readBinary(binary.getData(), (int)binary.getSize(), restored);
+        });
+
+        auto writeXml = nanosecondsPerCall(iterations, [&] {
+            juce::AudioProcessor::copyXmlToBinary(*StateChunk::createXml(state), xml);
+        });
+
+        auto readXml = nanosecondsPerCall(iterations, [&] {
+            if (auto parsed = juce::AudioProcessor::getXmlFromBinary(xml.getData(), (int)xml.getSize()))
+                StateChunk::readXml(*parsed, restored);
+        });
+
+        report.add("stateChunk",
+                   makeObject({ { "slots", numSlots } }),
+                   makeObject({ { "binaryWriteNs", writeBinary }, { "binaryReadNs", readBinary }, { "binaryBytes", (int)binary.getSize() },
+                                { "xmlWriteNs", writeXml }, { "xmlReadNs", readXml }, { "xmlBytes", (int)xml.getSize() } }));
+    }
+
+    void configureSlots(SimpleCCProcessor& processor, int numSlots)
+    {
+        SimpleCCProcessor::ScopedSlotUpdate update(processor);
+
+        for (int i = 0; i < NUM_SLOTS; ++i)
+        {
+            processor.setSlotEnabled(i, i < numSlots);
+            processor.setSlotCCNumber(i, 20 + i);
+            processor.setSlotMidiChannel(i, 1 + i % 4);
+        }
+    }
+
+    // Pass-through load: notes and controller data spread evenly over the block.
+    void fillPassThrough(juce::MidiBuffer& midi, int numEvents, int blockSize)
+    {
+        for (int i = 0; i < numEvents; ++i)
+        {
+            int position = i * blockSize / juce::jmax(1, numEvents);
+
+            switch (i % 3)
+            {
+                case 0:  midi.addEvent(juce::MidiMessage::noteOn(2, 36 + i % 48, (juce::uint8)100), position); break;
+                case 1:  midi.addEvent(juce::MidiMessage::controllerEvent(2, 74, i % 128), position); break;
+                default: midi.addEvent(juce::MidiMessage::noteOff(2, 36 + (i - 2) % 48), position); break;
+            }
+        }
+    }
+
+    void runProcessBlockBenchmark(Report& report, double seconds, int blockSize, int numSlots, double changeDensity, int passThroughEvents)
+    {
+        SimpleCCProcessor processor;
+        processor.setPlayConfigDetails(0, 0, sampleRate, blockSize);
+        configureSlots(processor, numSlots);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer(0, blockSize);
+        juce::MidiBuffer passThrough;
+        fillPassThrough(passThrough, passThroughEvents, blockSize);
+
+        juce::MidiBuffer midi;
+        midi.ensureSize(64 * 1024);
+
+        int numBlocks = juce::jmax(64, (int)(seconds * sampleRate / blockSize));
+        std::vector<double> durations;
+        durations.reserve((size_t)numBlocks);
+
+        juce::Random random(blockSize + numSlots);
+        CacheMissCounter cacheMissCounter;
+        double total = 0.0;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            // Parameter changes arrive from the host between blocks and are
+            // not part of the measurement.
+            for (int i = 0; i < numSlots; ++i)
+                if (random.nextDouble() < changeDensity)
+                    processor.getSlotParameter(i)->setValueNotifyingHost(random.nextFloat());
+
+            midi.clear();
+            midi.addEvents(passThrough, 0, -1, 0);
+
+            cacheMissCounter.start();
+            auto start = Clock::now();
+            processor.processBlock(buffer, midi);
+            std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+            cacheMissCounter.stop();
+
+            durations.push_back(elapsed.count());
+            total += elapsed.count();
+        }
+
+        processor.releaseResources();
+
+        double audioNs = (double)numBlocks * blockSize / sampleRate * 1.0e9;
+        double maximum = *std::max_element(durations.begin(), durations.end());
+
+        auto* metrics = makeObject({ { "blocks", numBlocks }, { "meanNs", total / numBlocks }, { "nsPerSample", total / ((double)numBlocks * blockSize) },
+                                     { "p50Ns", percentile(durations, 0.5) }, { "p99Ns", percentile(durations, 0.99) }, { "maxNs", maximum },
+                                     { "realtimeFactor", audioNs / total } });
+
+        if (cacheMissCounter.isAvailable())
+        {
+            metrics->setProperty("cacheMissesPerBlock", (double)cacheMissCounter.getCacheMisses() / numBlocks);
+            metrics->setProperty("l1dMissesPerBlock", (double)cacheMissCounter.getL1dMisses() / numBlocks);
+        }
+
+        report.add("processBlock",
+                   makeObject({ { "blockSize", blockSize }, { "slots", numSlots },
+                                { "changeDensity", changeDensity }, { "passThroughEvents", passThroughEvents } }),
+                   metrics);
+    }
+
+    void runProcessorStateBenchmark(Report& report, int iterations)
+    {
+        SimpleCCProcessor processor;
+        configureSlots(processor, NUM_SLOTS);
+
+        for (int p = 0; p < 8; ++p)
+        {
+            processor.setCurrentProgram(p);
+            configureSlots(processor, NUM_SLOTS - p);
+        }
+
+        processor.setCurrentProgram(0);
+
+        juce::MemoryBlock state;
+        int call = 0;
+
+        // Move a parameter between calls so the state cache is rebuilt each
+        // time, as it is when a host saves after automation.
+        auto getState = nanosecondsPerCall(iterations, [&] {
+            processor.getSlotParameter(0)->setValueNotifyingHost((float)(++call % 100) / 99.0f);
+            processor.getStateInformation(state);
+        });
+
+        // A blob equal to the cached state returns early, so restores
+        // alternate between two that differ in one slot value. Handing back
+        // the state that is already loaded is measured on its own.
+        juce::MemoryBlock states[2];
+
+        for (int i = 0; i < 2; ++i)
+        {
+            processor.getSlotParameter(0)->setValueNotifyingHost(i == 0 ? 0.25f : 0.75f);
+            processor.getStateInformation(states[i]);
+        }
+
+        auto setState = nanosecondsPerCall(iterations, [&] {
+            const auto& next = states[++call % 2];
+            processor.setStateInformation(next.getData(), (int)next.getSize());
+        });
+
+        const auto& current = states[call % 2];
+
+        auto setUnchangedState = nanosecondsPerCall(iterations, [&] {
+            processor.setStateInformation(current.getData(), (int)current.getSize());
+        });
+
+        report.add("processorState",
+                   makeObject({ { "slots", NUM_SLOTS }, { "programs", 8 } }),
+                   makeObject({ { "getStateNs", getState }, { "setStateNs", setState },
+                                { "setUnchangedStateNs", setUnchangedState }, { "bytes", (int)state.getSize() } }));
+    }
+
+    void writeSyntheticLibrary(const juce::File& directory, int numFiles)
+    {
+        directory.createDirectory();
+        juce::Random random(numFiles);
+
+        for (int f = 0; f < numFiles; ++f)
+        {
+            PresetBankPreset preset;
+            preset.manufacturer = "Maker " + juce::String(f % 37);
+            preset.name = "Preset " + juce::String(f);
+
+            for (int i = 0; i < NUM_SLOTS; ++i)
+            {
+                PresetBankSlot slot;
+                slot.ccNumber = random.nextInt(128);
+                slot.midiChannel = 1 + random.nextInt(16);
+                slot.enabled = random.nextBool();
+                slot.value = random.nextFloat();
+                slot.name = "Parameter " + juce::String(i + 1);
+                preset.slots.push_back(slot);
+            }
+
+            PresetBank::createPresetXml(preset)->writeTo(directory.getChildFile("preset" + juce::String(f) + ".xml"));
+        }
+    }
+
+    void runPresetScanBenchmark(Report& report, const juce::File& scratch, int numFiles)
+    {
+        auto directory = scratch.getChildFile("library" + juce::String(numFiles));
+        writeSyntheticLibrary(directory, numFiles);
+        SimpleCCProcessor::setPresetDirectoryOverride(directory);
+
+        SimpleCCProcessor processor;
+        int iterations = juce::jmax(1, 2000 / numFiles);
+        size_t found = 0;
+
+        auto scan = nanosecondsPerCall(iterations, [&] {
+            found = processor.getAllUserPresets().size();
+        });
+
+        SimpleCCProcessor::setPresetDirectoryOverride(scratch);
+        directory.deleteRecursively();
+
+        report.add("presetScan",
+                   makeObject({ { "files", numFiles } }),
+                   makeObject({ { "scanNs", scan }, { "nsPerFile", scan / numFiles }, { "presetsFound", (int)found } }));
+    }
+
+    void runEditorBenchmark(Report& report, int iterations)
+    {
+        SimpleCCProcessor processor;
+        std::unique_ptr<juce::AudioProcessorEditor> editor;
+        double destroy = 0.0;
+
+        auto create = nanosecondsPerCall(iterations, [&] {
+            editor.reset(processor.createEditor());
+
+            auto start = Clock::now();
+            editor.reset();
+            std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+            destroy += elapsed.count();
+        });
+
+        report.add("editor",
+                   makeObject({ { "iterations", iterations } }),
+                   makeObject({ { "constructNs", create - destroy / iterations }, { "destroyNs", destroy / iterations } }));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::File jsonFile;
+    bool quick = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        juce::String argument(argv[i]);
+
+        if (argument == "--json" && i + 1 < argc)
+            jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (argument == "--quick")
+            quick = true;
+    }
+
+    // Never read or write the user's own presets.
+    auto scratch = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                       .getNonexistentChildFile("SimpleCCBenchmarks", "", false);
+    scratch.createDirectory();
+    SimpleCCProcessor::setPresetDirectoryOverride(scratch);
+
+    Report report;
+    double seconds = quick ? 2.0 : 10.0;
+
+    runStateChunkBenchmark(report, 16, 20000);
+    runStateChunkBenchmark(report, 512, 1000);
+
+    for (int blockSize : { 32, 64, 128, 256, 512, 1024, 2048, 4096 })
+        runProcessBlockBenchmark(report, seconds, blockSize, NUM_SLOTS, 0.25, 0);
+
+    for (int numSlots : { 1, 4, 8, 16 })
+        runProcessBlockBenchmark(report, seconds, 256, numSlots, 0.25, 0);
+
+    for (double density : { 0.0, 0.1, 0.5, 1.0 })
+        runProcessBlockBenchmark(report, seconds, 256, NUM_SLOTS, density, 0);
+
+    for (int events : { 0, 16, 128, 1024 })
+        runProcessBlockBenchmark(report, seconds, 256, NUM_SLOTS, 0.25, events);
+
+    runProcessorStateBenchmark(report, 2000);
+
+    for (int numFiles : { 10, 1000, 10000 })
+        if (!quick || numFiles < 10000)
+            runPresetScanBenchmark(report, scratch, numFiles);
+
+    runEditorBenchmark(report, 20);
+
+    SimpleCCProcessor::setPresetDirectoryOverride({});
+    scratch.deleteRecursively();
+
+    if (jsonFile != juce::File() && !report.writeTo(jsonFile))
+    {
+        std::cerr << "Could not write " << jsonFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "BlockTimingRing.h"
+
+#include <cstring>
+
+BlockTimingRing::BlockTimingRing()
+{
+    for (auto& entry : entries)
+        entry.store(0);
+}
+
+void BlockTimingRing::push(float microseconds, float budgetMicroseconds) noexcept
+{
+    juce::uint32 words[2];
+    std::memcpy(&words[0], &microseconds, sizeof(float));
+    std::memcpy(&words[1], &budgetMicroseconds, sizeof(float));
+
+    auto index = numWritten.load(std::memory_order_relaxed);
+    entries[(size_t)(index % capacity)].store(((juce::uint64)words[1] << 32) | words[0], std::memory_order_relaxed);
+    numWritten.store(index + 1, std::memory_order_release);
+}
+
+juce::uint64 BlockTimingRing::readSince(juce::uint64 position, std::vector<Timing>& destination) const
+{
+    auto end = numWritten.load(std::memory_order_acquire);
+
+    // Leave a margin below capacity for entries the writer may be replacing
+    // while they are copied.
+    if (end - position > (juce::uint64)(capacity - 64))
+        position = end - (juce::uint64)juce::jmin((juce::uint64)(capacity - 64), end);
+
+    for (auto i = position; i < end; ++i)
+    {
+        auto packed = entries[(size_t)(i % capacity)].load(std::memory_order_relaxed);
+        auto low = (juce::uint32)(packed & 0xffffffffu);
+        auto high = (juce::uint32)(packed >> 32);
+
+        Timing timing;
+        std::memcpy(&timing.microseconds, &low, sizeof(float));
+        std::memcpy(&timing.budgetMicroseconds, &high, sizeof(float));
+        destination.push_back(timing);
+    }
+
+    return end;
+}
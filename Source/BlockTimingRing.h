@@ -0,0 +1,37 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+// The last few thousand processBlock durations, each with the real-time
+// budget of its block, for the editor to turn into statistics.
+//
+// The audio thread overwrites the oldest entry and never waits for a reader.
+// Each entry packs both floats into one 64-bit atomic, so a reader can never
+// see half of one block and half of another.
+
+class BlockTimingRing
+{
+public:
+    static constexpr int capacity = 2048;
+
+    struct Timing
+    {
+        float microseconds = 0.0f;
+        float budgetMicroseconds = 0.0f;
+    };
+
+    BlockTimingRing();
+
+    void push(float microseconds, float budgetMicroseconds) noexcept;
+
+    // Appends every entry written since position, skipping any that have
+    // already been overwritten, and returns the position to read from next.
+    juce::uint64 readSince(juce::uint64 position, std::vector<Timing>& destination) const;
+
+private:
+    std::array<std::atomic<juce::uint64>, capacity> entries;
+    std::atomic<juce::uint64> numWritten { 0 };
+};
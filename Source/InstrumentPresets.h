@@ -1,6 +1,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "SlotMessage.h"
 #include <vector>
 
 struct CCMapping
@@ -9,16 +10,53 @@ struct CCMapping
     juce::String paramName;
 };
 
+enum SysExChecksum
+{
+    checksumNone = 0,
+    checksumTwosComplement,  // (128 - sum % 128) % 128, as in Roland DT1 dumps
+    checksumSum              // sum & 0x7f
+};
+
+// Where slot i's value goes in a dump. The byte at offset only carries the
+// slot while the slot still sends to the destination the dump was written
+// for; its value is scaled into [minValue, maxValue].
+struct SysExSlotValue
+{
+    int offset = -1;
+    int messageType = SlotMessage::controlChange;
+    int channel = 1;
+    int number = 0;
+    int minValue = 0;
+    int maxValue = 127;
+};
+
+// A parameter-block dump that recalls every mapped slot in one message.
+// bytes is the complete message from F0 to F7, with each value byte holding
+// the parameter's default; slotValues[i] describes slot i's byte, or has an
+// offset of -1. The checksum covers bytes [checksumStart, checksumEnd) and is
+// written at checksumOffset.
+struct SysExTemplate
+{
+    std::vector<juce::uint8> bytes;
+    std::vector<SysExSlotValue> slotValues;
+    int checksum = checksumNone;
+    int checksumStart = 0;
+    int checksumEnd = 0;
+    int checksumOffset = -1;
+};
+
 struct InstrumentPreset
 {
     juce::String name;
     juce::String manufacturer;
     std::vector<CCMapping> mappings;
+    SysExTemplate sysex = {};
 };
 
-inline std::vector<InstrumentPreset> getInstrumentPresets()
+// Built once; every caller shares the same list.
+inline const std::vector<InstrumentPreset>& getInstrumentPresets()
 {
-    return {
+    static const std::vector<InstrumentPreset> presets {
         {
             "Access Virus TI",
             "Access",
@@ -368,6 +406,41 @@ inline std::vector<InstrumentPreset> getInstrumentPresets()
                 {25, "Filter LFO Depth"}
             }
         },
+        {
+            "Roland Sound Canvas",
+            "Roland",
+            {
+                {74, "TVF Cutoff"},
+                {71, "TVF Resonance"},
+                {73, "TVA Attack"},
+                {75, "TVA Decay"},
+                {72, "TVA Release"},
+                {76, "Vibrato Rate"},
+                {77, "Vibrato Depth"},
+                {78, "Vibrato Delay"}
+            },
+            // GS DT1 to part 1's tone modify block, 40 11 30-37: vibrato
+            // rate, depth, TVF cutoff, resonance, TVA attack, decay,
+            // release and vibrato delay. Each takes 0x0E-0x72 (-50 to +50)
+            // and defaults to 0x40; they are the parameters the GS CCs on
+            // channel 1 reach.
+            {
+                { 0xf0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x11, 0x30,
+                  0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+                  0x00, 0xf7 },
+                {
+                    { 10, SlotMessage::controlChange, 1, 74, 0x0e, 0x72 },
+                    { 11, SlotMessage::controlChange, 1, 71, 0x0e, 0x72 },
+                    { 12, SlotMessage::controlChange, 1, 73, 0x0e, 0x72 },
+                    { 13, SlotMessage::controlChange, 1, 75, 0x0e, 0x72 },
+                    { 14, SlotMessage::controlChange, 1, 72, 0x0e, 0x72 },
+                    { 8, SlotMessage::controlChange, 1, 76, 0x0e, 0x72 },
+                    { 9, SlotMessage::controlChange, 1, 77, 0x0e, 0x72 },
+                    { 15, SlotMessage::controlChange, 1, 78, 0x0e, 0x72 }
+                },
+                checksumTwosComplement, 5, 16, 16
+            }
+        },
         {
             "Sequential OB-6",
             "Sequential",
@@ -433,4 +506,6 @@ inline std::vector<InstrumentPreset> getInstrumentPresets()
             }
         }
     };
+
+    return presets;
 }
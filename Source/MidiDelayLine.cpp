@@ -0,0 +1,91 @@
+#include "MidiDelayLine.h"
+
+void MidiDelayLine::prepare(size_t capacityInBytes)
+{
+    storage.assign(capacityInBytes, 0);
+    scratch.assign(0xffff, 0);
+    reset();
+}
+
+void MidiDelayLine::reset()
+{
+    readPosition = 0;
+    writePosition = 0;
+    used = 0;
+}
+
+bool MidiDelayLine::push(juce::int64 dueTime, const juce::uint8* data, int numBytes)
+{
+    if (numBytes <= 0 || numBytes > 0xffff)
+        return false;
+
+    auto recordSize = headerSize + (size_t)numBytes;
+
+    if (storage.size() - used < recordSize)
+        return false;
+
+    auto size = (juce::uint16)numBytes;
+    write(&dueTime, sizeof(dueTime));
+    write(&size, sizeof(size));
+    write(data, (size_t)numBytes);
+    return true;
+}
+
+void MidiDelayLine::popDue(juce::int64 startTime, juce::int64 endTime, juce::MidiBuffer& destination)
+{
+    while (used >= headerSize)
+    {
+        juce::int64 dueTime;
+        peek(0, &dueTime, sizeof(dueTime));
+
+        if (dueTime >= endTime)
+            return;
+
+        auto size = popIntoScratch();
+        destination.addEvent(scratch.data(), size, (int)juce::jmax((juce::int64)0, dueTime - startTime));
+    }
+}
+
+void MidiDelayLine::flush(juce::MidiBuffer& destination, int samplePosition)
+{
+    while (used >= headerSize)
+    {
+        auto size = popIntoScratch();
+        destination.addEvent(scratch.data(), size, samplePosition);
+    }
+}
+
+// Copies the oldest event's bytes into scratch and removes it.
+int MidiDelayLine::popIntoScratch()
+{
+    juce::uint16 size;
+    peek(sizeof(juce::int64), &size, sizeof(size));
+    peek(headerSize, scratch.data(), size);
+
+    auto recordSize = headerSize + size;
+    readPosition = (readPosition + recordSize) % storage.size();
+    used -= recordSize;
+    return (int)size;
+}
+
+void MidiDelayLine::write(const void* source, size_t numBytes)
+{
+    auto* bytes = static_cast<const juce::uint8*>(source);
+    auto firstPart = juce::jmin(numBytes, storage.size() - writePosition);
+
+    std::memcpy(storage.data() + writePosition, bytes, firstPart);
+    std::memcpy(storage.data(), bytes + firstPart, numBytes - firstPart);
+
+    writePosition = (writePosition + numBytes) % storage.size();
+    used += numBytes;
+}
+
+void MidiDelayLine::peek(size_t offset, void* target, size_t numBytes) const
+{
+    auto* bytes = static_cast<juce::uint8*>(target);
+    auto start = (readPosition + offset) % storage.size();
+    auto firstPart = juce::jmin(numBytes, storage.size() - start);
+
+    std::memcpy(bytes, storage.data() + start, firstPart);
+    std::memcpy(bytes + firstPart, storage.data(), numBytes - firstPart);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Fixed-capacity FIFO of raw MIDI events stamped with the absolute sample
+// time at which they are due.
+//
+// Storage is allocated once in prepare(); push() and popDue() only copy bytes
+// into and out of a ring, so both are safe to call from processBlock. An event
+// that does not fit is refused and the caller decides what to do with it.
+
+class MidiDelayLine
+{
+public:
+    void prepare(size_t capacityInBytes);
+    void reset();
+
+    bool push(juce::int64 dueTime, const juce::uint8* data, int numBytes);
+    bool isEmpty() const { return used == 0; }
+
+    // Moves every event due before endTime into the buffer, positioned
+    // relative to startTime. Events that are already late land at sample 0.
+    void popDue(juce::int64 startTime, juce::int64 endTime, juce::MidiBuffer& destination);
+
+    // Moves every event, oldest first, to samplePosition regardless of when
+    // it is due.
+    void flush(juce::MidiBuffer& destination, int samplePosition);
+
+private:
+    static constexpr size_t headerSize = sizeof(juce::int64) + sizeof(juce::uint16);
+
+    void write(const void* source, size_t numBytes);
+    void peek(size_t offset, void* target, size_t numBytes) const;
+    int popIntoScratch();
+
+    std::vector<juce::uint8> storage;
+    std::vector<juce::uint8> scratch;
+    size_t readPosition = 0;
+    size_t writePosition = 0;
+    size_t used = 0;
+};
@@ -0,0 +1,155 @@
+#include "OutputCapture.h"
+
+#include <map>
+
+namespace
+{
+    // bytes in bits 0-23, size in bits 24-39, slot + 1 in bits 40-47.
+    juce::uint64 packPayload(int slot, const juce::uint8* data, int size)
+    {
+        juce::uint64 payload = 0;
+
+        for (int i = 0; i < juce::jmin(3, size); ++i)
+            payload |= (juce::uint64)data[i] << (8 * i);
+
+        return payload
+             | ((juce::uint64)(juce::jlimit(0, 0xffff, size)) << 24)
+             | ((juce::uint64)(juce::jlimit(0, 0xff, slot + 1)) << 40);
+    }
+}
+
+OutputCapture::OutputCapture()
+{
+    for (auto& time : times)
+        time.store(0);
+
+    for (auto& payload : payloads)
+        payload.store(0);
+
+    for (auto& byte : sysexBytes)
+        byte.store(0);
+}
+
+void OutputCapture::record(juce::int64 time, int slot, const juce::uint8* data, int size) noexcept
+{
+    if (frozen.load(std::memory_order_relaxed))
+        return;
+
+    auto index = numWritten.load(std::memory_order_relaxed);
+    auto position = (size_t)(index % capacity);
+
+    if (size > 3 && size <= maxSysExSize)
+    {
+        auto sequence = sysexSequence.load(std::memory_order_relaxed);
+        sysexSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (int i = 0; i < size; ++i)
+            sysexBytes[(size_t)i].store(data[i], std::memory_order_relaxed);
+
+        sysexSize.store(size, std::memory_order_relaxed);
+        sysexIndex.store(index, std::memory_order_relaxed);
+        sysexSequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    times[position].store(time, std::memory_order_relaxed);
+    payloads[position].store(packPayload(slot, data, size), std::memory_order_relaxed);
+    numWritten.store(index + 1, std::memory_order_release);
+}
+
+std::vector<OutputCapture::Event> OutputCapture::getEvents(juce::int64 maxAgeSamples) const
+{
+    auto end = numWritten.load(std::memory_order_acquire);
+
+    // Unless frozen, keep clear of the entries the audio thread may be
+    // overwriting while they are copied.
+    auto available = (juce::uint64)(isFrozen() ? capacity : capacity - 1024);
+    auto start = end - juce::jmin(end, available);
+
+    std::vector<Event> events;
+    events.reserve((size_t)(end - start));
+
+    for (auto i = start; i < end; ++i)
+    {
+        auto position = (size_t)(i % capacity);
+        auto payload = payloads[position].load(std::memory_order_relaxed);
+
+        Event event;
+        event.time = times[position].load(std::memory_order_relaxed);
+        event.size = (int)((payload >> 24) & 0xffff);
+        event.slot = (int)((payload >> 40) & 0xff) - 1;
+
+        for (int b = 0; b < 3; ++b)
+            event.bytes[b] = (juce::uint8)((payload >> (8 * b)) & 0xff);
+
+        events.push_back(event);
+    }
+
+    auto sequence = sysexSequence.load(std::memory_order_acquire);
+
+    if ((sequence & 1) == 0 && sequence != 0)
+    {
+        auto index = sysexIndex.load(std::memory_order_relaxed);
+        int size = sysexSize.load(std::memory_order_relaxed);
+
+        if (index >= start && index < end && events[(size_t)(index - start)].size == size)
+        {
+            std::vector<juce::uint8> bytes((size_t)size);
+
+            for (int i = 0; i < size; ++i)
+                bytes[(size_t)i] = sysexBytes[(size_t)i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (sysexSequence.load(std::memory_order_relaxed) == sequence)
+                events[(size_t)(index - start)].sysex = std::move(bytes);
+        }
+    }
+
+    if (!events.empty())
+    {
+        auto oldest = events.back().time - maxAgeSamples;
+        auto first = std::find_if(events.begin(), events.end(), [oldest](const Event& e) { return e.time >= oldest; });
+        events.erase(events.begin(), first);
+    }
+
+    return events;
+}
+
+bool OutputCapture::writeMidiFile(const std::vector<Event>& events, double sampleRate, juce::int64 startTime, const juce::File& file)
+{
+    if (sampleRate <= 0.0)
+        return false;
+
+    std::map<int, juce::MidiMessageSequence> tracks;
+
+    for (const auto& event : events)
+    {
+        auto& track = tracks[event.slot];
+
+        if (track.getNumEvents() == 0)
+        {
+            auto name = event.slot == noSlot ? juce::String("Macros and dumps") : "Slot " + juce::String(event.slot + 1);
+            track.addEvent(juce::MidiMessage::textMetaEvent(3, name), 0.0);
+        }
+
+        double milliseconds = (double)(event.time - startTime) * 1000.0 / sampleRate;
+
+        if (event.size > 3 && (int)event.sysex.size() == event.size)
+            track.addEvent(juce::MidiMessage(event.sysex.data(), event.size), milliseconds);
+        else if (event.size > 3)
+            track.addEvent(juce::MidiMessage::textMetaEvent(1, "SysEx dump, " + juce::String(event.size) + " bytes"), milliseconds);
+        else if (event.size > 0)
+            track.addEvent(juce::MidiMessage(event.bytes, event.size), milliseconds);
+    }
+
+    juce::MidiFile midiFile;
+    midiFile.setSmpteTimeFormat(25, 40);
+
+    for (auto& track : tracks)
+        midiFile.addTrack(track.second);
+
+    file.deleteFile();
+    juce::FileOutputStream stream(file);
+    return stream.openedOk() && midiFile.writeTo(stream);
+}
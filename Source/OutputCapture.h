@@ -0,0 +1,66 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+// The most recent messages SimpleCC generated, for finding out after the
+// fact where a stuck or wrong value came from.
+//
+// processBlock records each message's absolute sample time, the slot that
+// produced it and up to three bytes into a fixed ring of atomics, so
+// recording never allocates or waits. A SysEx dump goes into the ring by
+// length, and its bytes into one preallocated copy that the next dump
+// overwrites, so the most recent dump exports as the message that went out.
+// Freezing the capture stops recording so that what is exported is exactly
+// what was on screen when it was frozen.
+
+class OutputCapture
+{
+public:
+    static constexpr int capacity = 32768;
+    static constexpr int noSlot = -1;
+
+    struct Event
+    {
+        juce::int64 time = 0;
+        int slot = noSlot;
+        int size = 0;
+        juce::uint8 bytes[3] = {};
+        // The whole message, for the most recent SysEx dump only.
+        std::vector<juce::uint8> sysex;
+    };
+
+    OutputCapture();
+
+    void record(juce::int64 time, int slot, const juce::uint8* data, int size) noexcept;
+
+    void setFrozen(bool shouldBeFrozen) { frozen.store(shouldBeFrozen); }
+    bool isFrozen() const { return frozen.load(); }
+
+    // Oldest first, limited to events no older than maxAgeSamples before
+    // the newest one. Unless frozen, the entries the audio thread may be
+    // overwriting are left out.
+    std::vector<Event> getEvents(juce::int64 maxAgeSamples) const;
+
+    // One track per slot plus one for macros and SysEx dumps, with SMPTE timing at one tick
+    // per millisecond so event times read directly in a sequencer. startTime
+    // is the sample time written as zero. A dump whose bytes were not kept
+    // is written as a text event giving its length.
+    static bool writeMidiFile(const std::vector<Event>& events, double sampleRate, juce::int64 startTime, const juce::File& file);
+
+private:
+    std::array<std::atomic<juce::int64>, capacity> times;
+    std::array<std::atomic<juce::uint64>, capacity> payloads;
+    std::atomic<juce::uint64> numWritten { 0 };
+    std::atomic<bool> frozen { false };
+
+    // The last dump, guarded by a sequence number that is odd while it is
+    // being written; a copy that saw the number change is dropped.
+    static constexpr int maxSysExSize = 512;
+    std::array<std::atomic<juce::uint8>, maxSysExSize> sysexBytes;
+    std::atomic<int> sysexSize { 0 };
+    std::atomic<juce::uint64> sysexIndex { 0 };
+    std::atomic<juce::uint32> sysexSequence { 0 };
+};
@@ -1,10 +1,25 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "Tracing.h"
+
+namespace
+{
+    // Keep-alive interval for each entry of the resend mode selector.
+    constexpr int keepAliveChoices[] = { 0, 0, 5, 10, 30 };
+
+    // Leaves the text, and with it the caret and undo history, alone when it
+    // already matches.
+    void setTextIfChanged(juce::TextEditor& editor, const juce::String& text)
+    {
+        if (editor.getText() != text)
+            editor.setText(text, false);
+    }
+}
 
 SlotRowComponent::SlotRowComponent(SimpleCCProcessor& p, int slotIndex)
     : processor(p), index(slotIndex)
 {
-    auto& config = processor.getSlotConfig(index);
+    const auto& config = processor.getSlotConfig(index);
 
     slotNumberLabel.setText(juce::String(index + 1), juce::dontSendNotification);
     slotNumberLabel.setJustificationType(juce::Justification::centred);
@@ -13,11 +28,20 @@ SlotRowComponent::SlotRowComponent(SimpleCCProcessor& p, int slotIndex)
 
     enableButton.setToggleState(config.enabled, juce::dontSendNotification);
     enableButton.onClick = [this]() {
-        processor.getSlotConfig(index).enabled = enableButton.getToggleState();
+        processor.setSlotEnabled(index, enableButton.getToggleState());
         updateEnabledState();
     };
     addAndMakeVisible(enableButton);
 
+    for (int type = 0; type < SlotMessage::numTypes; ++type)
+        typeSelector.addItem(SlotMessage::encodings[type].name, type + 1);
+    typeSelector.setSelectedId(config.messageType + 1, juce::dontSendNotification);
+    typeSelector.onChange = [this]() {
+        processor.setSlotMessageType(index, typeSelector.getSelectedId() - 1);
+        updateEnabledState();
+    };
+    addAndMakeVisible(typeSelector);
+
     if (config.ccNumber >= 0)
         ccInput.setText(juce::String(config.ccNumber), false);
     else
@@ -28,13 +52,13 @@ SlotRowComponent::SlotRowComponent(SimpleCCProcessor& p, int slotIndex)
         juce::String text = ccInput.getText();
         if (text.isEmpty())
         {
-            processor.getSlotConfig(index).ccNumber = -1;
+            processor.setSlotCCNumber(index, -1);
         }
         else
         {
             int cc = text.getIntValue();
-            cc = juce::jlimit(0, 127, cc);
-            processor.getSlotConfig(index).ccNumber = cc;
+            cc = juce::jlimit(0, SlotMessage::getMaxNumber(processor.getSlotConfig(index).messageType), cc);
+            processor.setSlotCCNumber(index, cc);
             ccInput.setText(juce::String(cc), false);
         }
     };
@@ -42,13 +66,13 @@ SlotRowComponent::SlotRowComponent(SimpleCCProcessor& p, int slotIndex)
         juce::String text = ccInput.getText();
         if (text.isEmpty())
         {
-            processor.getSlotConfig(index).ccNumber = -1;
+            processor.setSlotCCNumber(index, -1);
         }
         else
         {
             int cc = text.getIntValue();
-            cc = juce::jlimit(0, 127, cc);
-            processor.getSlotConfig(index).ccNumber = cc;
+            cc = juce::jlimit(0, SlotMessage::getMaxNumber(processor.getSlotConfig(index).messageType), cc);
+            processor.setSlotCCNumber(index, cc);
             ccInput.setText(juce::String(cc), false);
         }
     };
@@ -58,10 +82,32 @@ SlotRowComponent::SlotRowComponent(SimpleCCProcessor& p, int slotIndex)
         channelSelector.addItem(juce::String(ch), ch);
     channelSelector.setSelectedId(config.midiChannel, juce::dontSendNotification);
     channelSelector.onChange = [this]() {
-        processor.getSlotConfig(index).midiChannel = channelSelector.getSelectedId();
+        processor.setSlotMidiChannel(index, channelSelector.getSelectedId());
     };
     addAndMakeVisible(channelSelector);
 
+    sourceSelector.addItem("Knob", sourceParameter + 1);
+    sourceSelector.addItem("Velocity", sourceVelocity + 1);
+    sourceSelector.addItem("Note", sourceNoteNumber + 1);
+    sourceSelector.addItem("Pressure", sourceChannelPressure + 1);
+    sourceSelector.addSectionHeading("Incoming CC");
+    for (int cc = 0; cc < 128; ++cc)
+        sourceSelector.addItem("CC " + juce::String(cc), 100 + cc);
+    sourceSelector.onChange = [this]() {
+        int id = sourceSelector.getSelectedId();
+        SlotSource source;
+        source.type = id >= 100 ? (int)sourceController : juce::jmax(1, id) - 1;
+        source.ccNumber = id >= 100 ? id - 100 : 0;
+        processor.setSlotSource(index, source);
+    };
+    addAndMakeVisible(sourceSelector);
+
+    gridSelector.addItemList({ "Free", "1/16", "1/8", "1/4", "1/2", "Bar" }, gridOff + 1);
+    gridSelector.onChange = [this]() {
+        processor.setSlotGridDivision(index, gridSelector.getSelectedId() - 1);
+    };
+    addAndMakeVisible(gridSelector);
+
     nameInput.setText(config.name, false);
     nameInput.setJustification(juce::Justification::centredLeft);
     nameInput.onFocusLost = [this]() {
@@ -74,13 +120,28 @@ SlotRowComponent::SlotRowComponent(SimpleCCProcessor& p, int slotIndex)
 
     addAndMakeVisible(activityIndicator);
 
-    updateEnabledState();
+    // Fills in the source and grid selectors too, and records the version
+    // shown, so the editor's first sync only touches rows that changed.
+    refreshFromProcessor();
     
     startTimerHz(30);
 }
 
 void SlotRowComponent::timerCallback()
 {
+    SIMPLECC_TRACE_SCOPE("SlotRowComponent::timerCallback");
+
+    syncWithProcessor();
+    
+    bool collision = processor.getDestinationMergePolicy() == mergeWarn && processor.hasSlotCollision(index);
+    
+    if (collision != showCollision)
+    {
+        showCollision = collision;
+        repaint();
+    }
+    
+
     if (processor.getSlotActivity(index))
     {
         activityIndicator.setActive(true);
@@ -92,20 +153,34 @@ void SlotRowComponent::timerCallback()
     }
 }
 
-void SlotRowComponent::refreshFromProcessor()
+bool SlotRowComponent::syncWithProcessor()
 {
-    auto& config = processor.getSlotConfig(index);
+    if (processor.getSlotVersion(index) == shownVersion)
+        return false;
     
-    enableButton.setToggleState(config.enabled, juce::dontSendNotification);
+    refreshFromProcessor();
+    return true;
+}
+
+void SlotRowComponent::refreshFromProcessor()
+{
+    SIMPLECC_TRACE_SCOPE("SlotRowComponent::refreshFromProcessor");
+
+    // Read before the config so a change made meanwhile is picked up next time.
+    shownVersion = processor.getSlotVersion(index);
     
-    if (config.ccNumber >= 0)
-        ccInput.setText(juce::String(config.ccNumber), false);
-    else
-        ccInput.setText("", false);
+    const auto& config = processor.getSlotConfig(index);
     
+    enableButton.setToggleState(config.enabled, juce::dontSendNotification);
+    typeSelector.setSelectedId(config.messageType + 1, juce::dontSendNotification);
+    setTextIfChanged(ccInput, config.ccNumber >= 0 ? juce::String(config.ccNumber) : juce::String());
     channelSelector.setSelectedId(config.midiChannel, juce::dontSendNotification);
     
-    nameInput.setText(config.name, false);
+    const auto& source = processor.getSlotSource(index);
+    sourceSelector.setSelectedId(source.type == sourceController ? 100 + source.ccNumber : source.type + 1, juce::dontSendNotification);
+    gridSelector.setSelectedId(processor.getSlotGridDivision(index) + 1, juce::dontSendNotification);
+    
+    setTextIfChanged(nameInput, config.name);
     
     updateEnabledState();
 }
@@ -113,14 +188,21 @@ void SlotRowComponent::refreshFromProcessor()
 void SlotRowComponent::updateEnabledState()
 {
     bool enabled = enableButton.getToggleState();
+    bool usesNumber = SlotMessage::usesNumber(processor.getSlotConfig(index).messageType);
     
-    ccInput.setEnabled(enabled);
+    typeSelector.setEnabled(enabled);
+    ccInput.setEnabled(enabled && usesNumber);
     channelSelector.setEnabled(enabled);
+    sourceSelector.setEnabled(enabled);
+    gridSelector.setEnabled(enabled);
     nameInput.setEnabled(enabled);
     
     float alpha = enabled ? 1.0f : 0.5f;
-    ccInput.setAlpha(alpha);
+    typeSelector.setAlpha(alpha);
+    ccInput.setAlpha(usesNumber ? alpha : 0.5f);
     channelSelector.setAlpha(alpha);
+    sourceSelector.setAlpha(alpha);
+    gridSelector.setAlpha(alpha);
     nameInput.setAlpha(alpha);
     slotNumberLabel.setAlpha(alpha);
 }
@@ -129,7 +211,9 @@ void SlotRowComponent::paint(juce::Graphics& g)
 {
     auto bounds = getLocalBounds().toFloat();
     
-    if (index % 2 == 0)
+    if (showCollision)
+        g.setColour(juce::Colour(0xff5a2a2a));
+    else if (index % 2 == 0)
         g.setColour(juce::Colour(0xff2a2a2a));
     else
         g.setColour(juce::Colour(0xff252525));
@@ -146,8 +230,11 @@ void SlotRowComponent::resized()
     
     int slotNumWidth = 30;
     int enableWidth = 30;
+    int typeWidth = 80;
     int ccWidth = 70;
     int channelWidth = 70;
+    int sourceWidth = 80;
+    int gridWidth = 60;
     int activityWidth = 20;
     int gap = 8;
     
@@ -157,12 +244,21 @@ void SlotRowComponent::resized()
     enableButton.setBounds(bounds.removeFromLeft(enableWidth));
     bounds.removeFromLeft(gap);
     
+    typeSelector.setBounds(bounds.removeFromLeft(typeWidth));
+    bounds.removeFromLeft(gap);
+    
     ccInput.setBounds(bounds.removeFromLeft(ccWidth));
     bounds.removeFromLeft(gap);
     
     channelSelector.setBounds(bounds.removeFromLeft(channelWidth));
     bounds.removeFromLeft(gap);
     
+    sourceSelector.setBounds(bounds.removeFromLeft(sourceWidth));
+    bounds.removeFromLeft(gap);
+    
+    gridSelector.setBounds(bounds.removeFromLeft(gridWidth));
+    bounds.removeFromLeft(gap);
+    
     auto activityBounds = bounds.removeFromRight(activityWidth);
     activityIndicator.setBounds(activityBounds);
     bounds.removeFromRight(gap);
@@ -170,9 +266,209 @@ void SlotRowComponent::resized()
     nameInput.setBounds(bounds);
 }
 
+BlockTimingDisplay::BlockTimingDisplay(const SimpleCCProcessor& p)
+    : processor(p)
+{
+    window.reserve(BlockTimingRing::capacity);
+    incoming.reserve(BlockTimingRing::capacity);
+    sorted.reserve(BlockTimingRing::capacity);
+    startTimerHz(4);
+}
+
+void BlockTimingDisplay::timerCallback()
+{
+    SIMPLECC_TRACE_SCOPE("BlockTimingDisplay::timerCallback");
+
+    incoming.clear();
+    readPosition = processor.getBlockTimings().readSince(readPosition, incoming);
+    
+    if (incoming.empty())
+        return;
+    
+    // Keep the most recent ring's worth of blocks; at 48 kHz and 256 samples
+    // that is about ten seconds.
+    window.insert(window.end(), incoming.begin(), incoming.end());
+    
+    if ((int)window.size() > BlockTimingRing::capacity)
+        window.erase(window.begin(), window.end() - BlockTimingRing::capacity);
+    
+    sorted.clear();
+    double totalTime = 0.0;
+    double totalBudget = 0.0;
+    
+    for (const auto& timing : window)
+    {
+        sorted.push_back(timing.microseconds);
+        totalTime += timing.microseconds;
+        totalBudget += timing.budgetMicroseconds;
+    }
+    
+    auto percentile = [this](double fraction) {
+        auto nth = sorted.begin() + (std::ptrdiff_t)((double)(sorted.size() - 1) * fraction);
+        std::nth_element(sorted.begin(), nth, sorted.end());
+        return *nth;
+    };
+    
+    float p50 = percentile(0.5);
+    float p99 = percentile(0.99);
+    float maximum = *std::max_element(sorted.begin(), sorted.end());
+    double load = totalBudget > 0.0 ? 100.0 * totalTime / totalBudget : 0.0;
+    
+    // Flag an instance whose slow blocks come within reach of the deadline.
+    const auto& latest = window.back();
+    nearDeadline = latest.budgetMicroseconds > 0.0f && p99 > latest.budgetMicroseconds * 0.5f;
+    
+    text = "p50 " + juce::String(p50, 1) + "  p99 " + juce::String(p99, 1)
+         + "  max " + juce::String(maximum, 1) + " us  load " + juce::String(load, 2) + "%";
+    repaint();
+}
+
+void BlockTimingDisplay::paint(juce::Graphics& g)
+{
+    g.setColour(nearDeadline ? juce::Colours::orange : juce::Colours::white.withAlpha(0.8f));
+    g.setFont(juce::Font(11.0f, juce::Font::plain));
+    g.drawText(text, getLocalBounds(), juce::Justification::centredRight, true);
+}
+
+MacroDestinationRow::MacroDestinationRow(SimpleCCProcessor& p, int macroIndex, int destinationIndex)
+    : processor(p), macro(macroIndex), destination(destinationIndex)
+{
+    destinationLabel.setText("M" + juce::String(macro + 1) + "." + juce::String(destination + 1), juce::dontSendNotification);
+    destinationLabel.setJustificationType(juce::Justification::centred);
+    destinationLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    addAndMakeVisible(destinationLabel);
+
+    enableButton.onClick = [this]() { commit(); };
+    addAndMakeVisible(enableButton);
+
+    for (auto* input : { &ccInput, &minInput, &maxInput })
+    {
+        input->setJustification(juce::Justification::centred);
+        input->setInputRestrictions(3, "0123456789");
+        input->onFocusLost = [this]() { commit(); };
+        input->onReturnKey = [this]() { commit(); };
+        addAndMakeVisible(input);
+    }
+
+    for (int ch = 1; ch <= 16; ++ch)
+        channelSelector.addItem(juce::String(ch), ch);
+    channelSelector.onChange = [this]() { commit(); };
+    addAndMakeVisible(channelSelector);
+
+    curveSelector.addItem("Linear", macroCurveLinear + 1);
+    curveSelector.addItem("Exp", macroCurveExponential + 1);
+    curveSelector.addItem("Log", macroCurveLogarithmic + 1);
+    curveSelector.onChange = [this]() { commit(); };
+    addAndMakeVisible(curveSelector);
+
+    refreshFromProcessor();
+}
+
+void MacroDestinationRow::refreshFromProcessor()
+{
+    const auto& config = processor.getMacroDestination(macro, destination);
+
+    enableButton.setToggleState(config.enabled, juce::dontSendNotification);
+    setTextIfChanged(ccInput, config.ccNumber >= 0 ? juce::String(config.ccNumber) : juce::String());
+    channelSelector.setSelectedId(config.midiChannel, juce::dontSendNotification);
+    setTextIfChanged(minInput, juce::String(config.minValue));
+    setTextIfChanged(maxInput, juce::String(config.maxValue));
+    curveSelector.setSelectedId(config.curve + 1, juce::dontSendNotification);
+
+    bool collision = processor.getDestinationMergePolicy() == mergeWarn && processor.hasMacroCollision(macro, destination);
+
+    if (collision != showCollision)
+    {
+        showCollision = collision;
+        repaint();
+    }
+}
+
+void MacroDestinationRow::commit()
+{
+    MacroDestination config;
+    config.enabled = enableButton.getToggleState();
+    config.ccNumber = ccInput.getText().isEmpty() ? -1 : juce::jlimit(0, 127, ccInput.getText().getIntValue());
+    config.midiChannel = juce::jmax(1, channelSelector.getSelectedId());
+    config.minValue = juce::jlimit(0, 127, minInput.getText().getIntValue());
+    config.maxValue = maxInput.getText().isEmpty() ? 127 : juce::jlimit(0, 127, maxInput.getText().getIntValue());
+    config.curve = juce::jmax(1, curveSelector.getSelectedId()) - 1;
+
+    processor.setMacroDestination(macro, destination, config);
+    refreshFromProcessor();
+
+    if (onChange)
+        onChange();
+}
+
+void MacroDestinationRow::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().toFloat();
+
+    if (showCollision)
+        g.setColour(juce::Colour(0xff5a2a2a));
+    else if (macro % 2 == 0)
+        g.setColour(juce::Colour(0xff2a2a2a));
+    else
+        g.setColour(juce::Colour(0xff252525));
+
+    g.fillRect(bounds);
+
+    g.setColour(juce::Colour(0xff3a3a3a));
+    g.drawLine(0, bounds.getHeight(), bounds.getWidth(), bounds.getHeight(), 1.0f);
+}
+
+void MacroDestinationRow::resized()
+{
+    auto bounds = getLocalBounds().reduced(4, 2);
+    int gap = 6;
+
+    destinationLabel.setBounds(bounds.removeFromLeft(40));
+    bounds.removeFromLeft(gap);
+    enableButton.setBounds(bounds.removeFromLeft(30));
+    bounds.removeFromLeft(gap);
+    ccInput.setBounds(bounds.removeFromLeft(50));
+    bounds.removeFromLeft(gap);
+    channelSelector.setBounds(bounds.removeFromLeft(60));
+    bounds.removeFromLeft(gap);
+    minInput.setBounds(bounds.removeFromLeft(45));
+    bounds.removeFromLeft(gap);
+    maxInput.setBounds(bounds.removeFromLeft(45));
+    bounds.removeFromLeft(gap);
+    curveSelector.setBounds(bounds);
+}
+
 SimpleCCEditor::SimpleCCEditor(SimpleCCProcessor& p)
-    : AudioProcessorEditor(&p), processorRef(p)
+    : AudioProcessorEditor(&p), processorRef(p), timingDisplay(p)
 {
+    addAndMakeVisible(timingDisplay);
+    
+    freezeCaptureButton.setButtonText("Freeze");
+    freezeCaptureButton.setClickingTogglesState(true);
+    freezeCaptureButton.setToggleState(processorRef.getOutputCapture().isFrozen(), juce::dontSendNotification);
+    freezeCaptureButton.onClick = [this]() {
+        processorRef.getOutputCapture().setFrozen(freezeCaptureButton.getToggleState());
+    };
+    addAndMakeVisible(freezeCaptureButton);
+    
+    exportCaptureButton.setButtonText("Export");
+    exportCaptureButton.onClick = [this]() { exportCapture(); };
+    addAndMakeVisible(exportCaptureButton);
+    
+   #if SIMPLECC_TRACING
+    traceButton.setButtonText("Trace");
+    traceButton.onClick = [this]() {
+        auto file = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                        .getNonexistentChildFile("SimpleCC Trace", ".json");
+        
+        if (Tracing::writeChromeTrace(file))
+            juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::InfoIcon, "Trace saved", file.getFullPathName());
+        else
+            juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Trace failed", "Could not write " + file.getFullPathName());
+    };
+    addAndMakeVisible(traceButton);
+   #endif
+    
     presetLabel.setText("Instrument:", juce::dontSendNotification);
     presetLabel.setJustificationType(juce::Justification::centredRight);
     presetLabel.setColour(juce::Label::textColourId, juce::Colours::lightgrey);
@@ -187,16 +483,12 @@ SimpleCCEditor::SimpleCCEditor(SimpleCCProcessor& p)
         {
             // Empty preset selected - clear preset tracking
             processorRef.resetAllSlotConfigs();
-            for (auto* row : slotRows)
-            {
-                row->refreshFromProcessor();
-            }
+            syncSlotRows();
         }
         else if (selectedId >= userPresetStartId && selectedId < userPresetStartId + (int)cachedUserPresets.size())
         {
             int userPresetIndex = selectedId - userPresetStartId;
-            juce::File presetDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
-                .getChildFile("SimpleCC").getChildFile("Presets");
+            juce::File presetDir = SimpleCCProcessor::getPresetDirectory();
             
             juce::String manufacturer = cachedUserPresets[userPresetIndex].first;
             juce::String name = cachedUserPresets[userPresetIndex].second;
@@ -210,10 +502,14 @@ SimpleCCEditor::SimpleCCEditor(SimpleCCProcessor& p)
             juce::File presetFile = presetDir.getChildFile(safeFilename);
             processorRef.loadUserPresetFromFile(presetFile);
             
-            for (auto* row : slotRows)
-            {
-                row->refreshFromProcessor();
-            }
+            syncSlotRows();
+        }
+        else if (selectedId >= bankPresetStartId && selectedId < bankPresetStartId + (int)cachedBankPresets.size())
+        {
+            const auto& bankPreset = cachedBankPresets[selectedId - bankPresetStartId];
+            processorRef.loadPresetFromBank(bankPreset.first, bankPreset.second);
+            
+            syncSlotRows();
         }
         else if (selectedId >= defaultPresetStartId)
         {
@@ -234,12 +530,144 @@ SimpleCCEditor::SimpleCCEditor(SimpleCCProcessor& p)
     resetButton.onClick = [this]() { resetAllSlots(); };
     addAndMakeVisible(resetButton);
     
+    searchInput.setTextToShowWhenEmpty("Search presets...", juce::Colours::lightgrey.withAlpha(0.6f));
+    searchInput.onTextChange = [this]() { updateSearchResults(); };
+    searchInput.onReturnKey = [this]() { loadSearchResult(juce::jmax(0, searchResults.getSelectedRow())); };
+    searchInput.onEscapeKey = [this]() {
+        searchInput.clear();
+        updateSearchResults();
+    };
+    addAndMakeVisible(searchInput);
+    
+    searchResults.setModel(this);
+    searchResults.setRowHeight(24);
+    searchResults.setColour(juce::ListBox::backgroundColourId, juce::Colour(0xff202020));
+    addChildComponent(searchResults);
+    
+    rebuildProgramSelector();
+    programSelector.onChange = [this]() {
+        int program = programSelector.getSelectedId() - 1;
+        
+        if (program >= 0 && program != processorRef.getCurrentProgram())
+            processorRef.setCurrentProgram(program);
+    };
+    addAndMakeVisible(programSelector);
+    
+    programChangeChannelSelector.addItem("PC Off", 1);
+    programChangeChannelSelector.addItem("PC Omni", 2);
+    for (int ch = 1; ch <= 16; ++ch)
+        programChangeChannelSelector.addItem("PC " + juce::String(ch), ch + 2);
+    programChangeChannelSelector.onChange = [this]() {
+        processorRef.setProgramChangeChannel(programChangeChannelSelector.getSelectedId() - 2);
+    };
+    addAndMakeVisible(programChangeChannelSelector);
+    
+    morphLabel.setText("Morph:", juce::dontSendNotification);
+    morphLabel.setJustificationType(juce::Justification::centredRight);
+    morphLabel.setColour(juce::Label::textColourId, juce::Colours::lightgrey);
+    addAndMakeVisible(morphLabel);
+    
+    morphModeSelector.addItemList(processorRef.getMorphModeParameter()->choices, 1);
+    morphModeAttachment = std::make_unique<juce::ComboBoxParameterAttachment>(*processorRef.getMorphModeParameter(), morphModeSelector);
+    addAndMakeVisible(morphModeSelector);
+    
+    for (int i = 0; i < NUM_SNAPSHOTS; ++i)
+    {
+        auto* button = new juce::TextButton(juce::String::charToString((juce::juce_wchar)('A' + i)));
+        button->onClick = [this, i]() { processorRef.captureSnapshot(i); };
+        snapshotButtons.add(button);
+        addAndMakeVisible(button);
+    }
+    
+    for (auto* slider : { &morphXSlider, &morphYSlider })
+    {
+        slider->setSliderStyle(juce::Slider::LinearHorizontal);
+        slider->setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+        addAndMakeVisible(slider);
+    }
+    
+    morphXAttachment = std::make_unique<juce::SliderParameterAttachment>(*processorRef.getMorphXParameter(), morphXSlider);
+    morphYAttachment = std::make_unique<juce::SliderParameterAttachment>(*processorRef.getMorphYParameter(), morphYSlider);
+    
+    for (int m = 0; m < NUM_MACROS; ++m)
+    {
+        for (int d = 0; d < MACRO_DESTINATIONS; ++d)
+        {
+            auto* row = new MacroDestinationRow(processorRef, m, d);
+            row->onChange = [this]() {
+                for (auto* other : macroRows)
+                    other->refreshFromProcessor();
+            };
+            macroRows.add(row);
+            macroContainer.addAndMakeVisible(row);
+        }
+    }
+    
+    macroViewport.setViewedComponent(&macroContainer, false);
+    macroViewport.setScrollBarsShown(true, false);
+    addChildComponent(macroViewport);
+    
+    macrosButton.setButtonText("Macros");
+    macrosButton.setClickingTogglesState(true);
+    macrosButton.onClick = [this]() {
+        bool showMacros = macrosButton.getToggleState();
+        
+        if (showMacros)
+        {
+            for (auto* row : macroRows)
+                row->refreshFromProcessor();
+        }
+        
+        macroViewport.setVisible(showMacros);
+        viewport.setVisible(!showMacros);
+        headerSlot.setText(showMacros ? "MACRO" : "SLOT", juce::dontSendNotification);
+        headerName.setText(showMacros ? "MIN   MAX   CURVE" : "NAME", juce::dontSendNotification);
+    };
+    addAndMakeVisible(macrosButton);
+    
     versionLabel.setText("Version: " SIMPLECC_VERSION, juce::dontSendNotification);
     versionLabel.setJustificationType(juce::Justification::centredLeft);
     versionLabel.setColour(juce::Label::textColourId, juce::Colours::lightgrey.withAlpha(0.6f));
     versionLabel.setFont(juce::Font(10.0f, juce::Font::plain));
     addAndMakeVisible(versionLabel);
     
+    mergePolicySelector.addItem("Overlap: Last wins", mergeLastWins + 1);
+    mergePolicySelector.addItem("Overlap: Max", mergeMax + 1);
+    mergePolicySelector.addItem("Overlap: Average", mergeAverage + 1);
+    mergePolicySelector.addItem("Overlap: Warn", mergeWarn + 1);
+    mergePolicySelector.onChange = [this]() {
+        processorRef.setDestinationMergePolicy(mergePolicySelector.getSelectedId() - 1);
+        
+        for (auto* row : macroRows)
+            row->refreshFromProcessor();
+    };
+    addAndMakeVisible(mergePolicySelector);
+    
+    resendButton.setButtonText("Resend");
+    resendButton.onClick = [this]() { processorRef.requestRefresh(); };
+    addAndMakeVisible(resendButton);
+    
+    resendModeSelector.addItem("Resend: Manual", 1);
+    resendModeSelector.addItem("Resend: On play", 2);
+    resendModeSelector.addItem("On play + 5s", 3);
+    resendModeSelector.addItem("On play + 10s", 4);
+    resendModeSelector.addItem("On play + 30s", 5);
+    
+    resendModeSelector.onChange = [this]() {
+        int id = resendModeSelector.getSelectedId();
+        processorRef.setRefreshOnTransportStart(id >= 2);
+        processorRef.setKeepAliveSeconds(keepAliveChoices[juce::jlimit(1, 5, id) - 1]);
+    };
+    addAndMakeVisible(resendModeSelector);
+    
+    lookaheadSelector.addItem("Ahead: off", 1);
+    for (int ms : { 1, 2, 5, 10 })
+        lookaheadSelector.addItem("Ahead: " + juce::String(ms) + " ms", ms + 1);
+    lookaheadSelector.onChange = [this]() {
+        processorRef.setLookaheadMs(lookaheadSelector.getSelectedId() - 1);
+    };
+    addAndMakeVisible(lookaheadSelector);
+    
     auto setupHeader = [](juce::Label& label, const juce::String& text, juce::Justification just = juce::Justification::centred) {
         label.setText(text, juce::dontSendNotification);
         label.setJustificationType(just);
@@ -247,14 +675,20 @@ SimpleCCEditor::SimpleCCEditor(SimpleCCProcessor& p)
     };
     
     setupHeader(headerSlot, "SLOT");
+    setupHeader(headerType, "TYPE");
     setupHeader(headerCC, "CC");
     setupHeader(headerCh, "CH");
+    setupHeader(headerSource, "SOURCE");
+    setupHeader(headerGrid, "GRID");
     setupHeader(headerName, "NAME", juce::Justification::centredLeft);
     setupHeader(headerActivity, "");
     
     addAndMakeVisible(headerSlot);
+    addAndMakeVisible(headerType);
     addAndMakeVisible(headerCC);
     addAndMakeVisible(headerCh);
+    addAndMakeVisible(headerSource);
+    addAndMakeVisible(headerGrid);
     addAndMakeVisible(headerName);
     addAndMakeVisible(headerActivity);
 
@@ -269,25 +703,30 @@ SimpleCCEditor::SimpleCCEditor(SimpleCCProcessor& p)
     viewport.setScrollBarsShown(true, false);
     addAndMakeVisible(viewport);
 
+    processorRef.getPresetWriter().addListener(this);
+    
     processorRef.loadUserPreset();
-    for (auto* row : slotRows)
-    {
-        row->refreshFromProcessor();
-    }
+    syncSlotRows();
+    refreshStateControls();
+    shownStateVersion = processorRef.getStateVersion();
+    startTimerHz(10);
 
     int rowHeight = 28;
     int logoHeight = 50;
     int presetBarHeight = 32;
+    int searchBarHeight = 28;
+    int morphBarHeight = 28;
     int headerHeight = 28;
-    int totalHeight = logoHeight + presetBarHeight + headerHeight + (NUM_SLOTS * rowHeight) + 20;
+    int totalHeight = logoHeight + presetBarHeight + searchBarHeight + morphBarHeight + headerHeight + (NUM_SLOTS * rowHeight) + 20;
     
-    setSize(480, totalHeight);
+    setSize(718, totalHeight);
     setResizable(true, true);
-    setResizeLimits(380, 200, 800, 700);
+    setResizeLimits(618, 200, 960, 760);
 }
 
 SimpleCCEditor::~SimpleCCEditor()
 {
+    processorRef.getPresetWriter().removeListener(this);
 }
 
 void SimpleCCEditor::drawLogo(juce::Graphics& g, juce::Rectangle<float> bounds)
@@ -305,6 +744,8 @@ void SimpleCCEditor::drawLogo(juce::Graphics& g, juce::Rectangle<float> bounds)
 
 void SimpleCCEditor::paint(juce::Graphics& g)
 {
+    SIMPLECC_TRACE_SCOPE("SimpleCCEditor::paint");
+
     g.fillAll(juce::Colour(0xff2a2a2a));
     
     juce::Rectangle<float> headerArea(0.0f, 0.0f, (float)getWidth(), 82.0f);
@@ -323,7 +764,16 @@ void SimpleCCEditor::resized()
 {
     auto bounds = getLocalBounds();
     
-    bounds.removeFromTop(50);
+    auto logoBounds = bounds.removeFromTop(50);
+    timingDisplay.setBounds(logoBounds.removeFromRight(250).reduced(8, 12));
+    exportCaptureButton.setBounds(logoBounds.removeFromRight(56).reduced(0, 12));
+    logoBounds.removeFromRight(4);
+    freezeCaptureButton.setBounds(logoBounds.removeFromRight(56).reduced(0, 12));
+    logoBounds.removeFromRight(8);
+    
+   #if SIMPLECC_TRACING
+    traceButton.setBounds(logoBounds.removeFromRight(50).reduced(0, 12));
+   #endif
     
     auto presetBounds = bounds.removeFromTop(32).reduced(8, 4);
     presetLabel.setBounds(presetBounds.removeFromLeft(80));
@@ -334,22 +784,58 @@ void SimpleCCEditor::resized()
     presetBounds.removeFromLeft(8);
     resetButton.setBounds(presetBounds.removeFromLeft(50));
     
+    auto searchBounds = bounds.removeFromTop(28).reduced(8, 2);
+    programChangeChannelSelector.setBounds(searchBounds.removeFromRight(80));
+    searchBounds.removeFromRight(8);
+    programSelector.setBounds(searchBounds.removeFromRight(130));
+    searchBounds.removeFromRight(8);
+    searchInput.setBounds(searchBounds);
+    
+    auto morphBounds = bounds.removeFromTop(28).reduced(8, 2);
+    morphLabel.setBounds(morphBounds.removeFromLeft(52));
+    morphBounds.removeFromLeft(4);
+    morphModeSelector.setBounds(morphBounds.removeFromLeft(70));
+    morphBounds.removeFromLeft(8);
+    
+    for (auto* button : snapshotButtons)
+    {
+        button->setBounds(morphBounds.removeFromLeft(24));
+        morphBounds.removeFromLeft(2);
+    }
+    
+    macrosButton.setBounds(morphBounds.removeFromRight(60));
+    morphBounds.removeFromRight(8);
+    
+    morphBounds.removeFromLeft(6);
+    morphXSlider.setBounds(morphBounds.removeFromLeft(morphBounds.getWidth() / 2));
+    morphYSlider.setBounds(morphBounds);
+    
     auto headerBounds = bounds.removeFromTop(28).reduced(4, 2);
     
     int slotNumWidth = 30;
     int enableWidth = 30;
+    int typeWidth = 80;
     int ccWidth = 70;
     int channelWidth = 70;
+    int sourceWidth = 80;
+    int gridWidth = 60;
     int activityWidth = 20;
     int gap = 8;
     
     int slotHeaderWidth = slotNumWidth + gap + enableWidth;
     headerSlot.setBounds(headerBounds.removeFromLeft(slotHeaderWidth));
+    headerBounds.removeFromLeft(gap);
+    headerType.setBounds(headerBounds.removeFromLeft(typeWidth));
+    headerBounds.removeFromLeft(gap);
     
     headerCC.setBounds(headerBounds.removeFromLeft(ccWidth));
     headerBounds.removeFromLeft(gap);
     headerCh.setBounds(headerBounds.removeFromLeft(channelWidth));
     headerBounds.removeFromLeft(gap);
+    headerSource.setBounds(headerBounds.removeFromLeft(sourceWidth));
+    headerBounds.removeFromLeft(gap);
+    headerGrid.setBounds(headerBounds.removeFromLeft(gridWidth));
+    headerBounds.removeFromLeft(gap);
     
     headerActivity.setBounds(headerBounds.removeFromRight(activityWidth));
     headerBounds.removeFromRight(gap);
@@ -358,9 +844,17 @@ void SimpleCCEditor::resized()
     
     auto viewportBounds = bounds;
     auto versionBounds = viewportBounds.removeFromBottom(20).reduced(8, 2);
+    mergePolicySelector.setBounds(versionBounds.removeFromRight(130));
+    versionBounds.removeFromRight(4);
+    resendModeSelector.setBounds(versionBounds.removeFromRight(110));
+    versionBounds.removeFromRight(4);
+    resendButton.setBounds(versionBounds.removeFromRight(56));
+    versionBounds.removeFromRight(4);
+    lookaheadSelector.setBounds(versionBounds.removeFromRight(90));
     versionLabel.setBounds(versionBounds);
     
     viewport.setBounds(viewportBounds);
+    searchResults.setBounds(viewportBounds);
     viewport.setScrollBarsShown(false, false);
     
     int rowHeight = 28;
@@ -373,43 +867,53 @@ void SimpleCCEditor::resized()
     {
         slotRows[i]->setBounds(0, i * rowHeight, containerWidth, rowHeight);
     }
+    
+    macroViewport.setBounds(viewportBounds);
+    int macroWidth = viewportBounds.getWidth() - macroViewport.getScrollBarThickness();
+    macroContainer.setSize(macroWidth, macroRows.size() * rowHeight);
+    
+    for (int i = 0; i < macroRows.size(); ++i)
+        macroRows[i]->setBounds(0, i * rowHeight, macroWidth, rowHeight);
 }
 
 void SimpleCCEditor::applyPreset(int presetIndex)
 {
-    auto presets = getInstrumentPresets();
+    const auto& presets = getInstrumentPresets();
     
     if (presetIndex < 0 || presetIndex >= (int)presets.size())
         return;
     
     const auto& preset = presets[presetIndex];
     
-    processorRef.loadDefaultPreset(preset.manufacturer, preset.name);
-    
-    int numMappings = juce::jmin((int)preset.mappings.size(), NUM_SLOTS);
-    
-    for (int i = 0; i < NUM_SLOTS; ++i)
+    // Slot versions are published when the update ends, so sync after it.
     {
-        auto& config = processorRef.getSlotConfig(i);
+        SimpleCCProcessor::ScopedSlotUpdate update(processorRef);
+        processorRef.loadDefaultPreset(preset.manufacturer, preset.name);
         
-        if (i < numMappings)
-        {
-            config.enabled = true;
-            config.ccNumber = preset.mappings[i].ccNumber;
-            processorRef.updateSlotName(i, preset.mappings[i].paramName);
-        }
-        else
+        int numMappings = juce::jmin((int)preset.mappings.size(), NUM_SLOTS);
+        
+        for (int i = 0; i < NUM_SLOTS; ++i)
         {
-            config.enabled = false;
-            config.ccNumber = -1;
-            processorRef.updateSlotName(i, "Slot " + juce::String(i + 1));
+            // Instrument presets map controllers; a slot left on another
+            // type would send that type on the preset's CC number.
+            processorRef.setSlotMessageType(i, SlotMessage::controlChange);
+            
+            if (i < numMappings)
+            {
+                processorRef.setSlotEnabled(i, true);
+                processorRef.setSlotCCNumber(i, preset.mappings[i].ccNumber);
+                processorRef.updateSlotName(i, preset.mappings[i].paramName);
+            }
+            else
+            {
+                processorRef.setSlotEnabled(i, false);
+                processorRef.setSlotCCNumber(i, -1);
+                processorRef.updateSlotName(i, "Slot " + juce::String(i + 1));
+            }
         }
     }
     
-    for (auto* row : slotRows)
-    {
-        row->refreshFromProcessor();
-    }
+    syncSlotRows();
 }
 
 void SimpleCCEditor::saveCustomPreset()
@@ -446,8 +950,6 @@ void SimpleCCEditor::saveCustomPreset()
             }
             
             processorRef.saveCurrentStateAsUserPreset(manufacturer, name);
-            rebuildPresetDropdown();
-            selectUserPreset(manufacturer, name);
         }
         delete alertWindow;
     }), true);
@@ -466,23 +968,31 @@ void SimpleCCEditor::resetAllSlots()
         if (result == 1)
         {
             processorRef.resetAllSlotConfigs();
-            for (auto* row : slotRows)
-            {
-                row->refreshFromProcessor();
-            }
+            syncSlotRows();
             presetSelector.setSelectedId(1, juce::dontSendNotification);
         }
     });
 }
 
+// Rescans the user preset directory and the banks, then refills the menu.
 void SimpleCCEditor::rebuildPresetDropdown()
+{
+    SIMPLECC_TRACE_SCOPE("rebuildPresetDropdown");
+
+    cachedUserPresets = processorRef.getAllUserPresets();
+    processorRef.refreshPresetBanks();
+    populatePresetDropdown();
+}
+
+// Refills the menu from what is already loaded; touches no files.
+void SimpleCCEditor::populatePresetDropdown()
 {
     presetSelector.clear(juce::dontSendNotification);
+    searchIndexValid = false;
     
     int nextId = 1;
     presetSelector.addItem("", nextId++);
     
-    cachedUserPresets = processorRef.getAllUserPresets();
     userPresetStartId = nextId;
     
     for (const auto& preset : cachedUserPresets)
@@ -495,7 +1005,27 @@ void SimpleCCEditor::rebuildPresetDropdown()
         presetSelector.addSeparator();
     }
     
-    auto presets = getInstrumentPresets();
+    cachedBankPresets.clear();
+    bankPresetStartId = nextId;
+    
+    for (int b = 0; b < processorRef.getNumPresetBanks(); ++b)
+    {
+        auto* bank = processorRef.getPresetBank(b);
+        presetSelector.addSectionHeading(bank->getFile().getFileNameWithoutExtension());
+        
+        for (int i = 0; i < bank->getNumPresets(); ++i)
+        {
+            presetSelector.addItem(bank->getManufacturer(i) + " - " + bank->getName(i), nextId++);
+            cachedBankPresets.push_back({b, i});
+        }
+    }
+    
+    if (!cachedBankPresets.empty())
+    {
+        presetSelector.addSeparator();
+    }
+    
+    const auto& presets = getInstrumentPresets();
     defaultPresetStartId = nextId;
     
     std::vector<juce::String> manufacturers;
@@ -526,6 +1056,9 @@ void SimpleCCEditor::rebuildPresetDropdown()
             }
         }
     }
+    
+    if (searchInput.getText().isNotEmpty())
+        updateSearchResults();
 }
 
 void SimpleCCEditor::selectUserPreset(const juce::String& manufacturer, const juce::String& name)
@@ -538,6 +1071,18 @@ void SimpleCCEditor::selectUserPreset(const juce::String& manufacturer, const ju
             return;
         }
     }
+    
+    for (int i = 0; i < (int)cachedBankPresets.size(); ++i)
+    {
+        auto* bank = processorRef.getPresetBank(cachedBankPresets[i].first);
+        int presetIndex = cachedBankPresets[i].second;
+        
+        if (bank != nullptr && bank->getManufacturer(presetIndex) == manufacturer && bank->getName(presetIndex) == name)
+        {
+            presetSelector.setSelectedId(bankPresetStartId + i, juce::dontSendNotification);
+            return;
+        }
+    }
 }
 
 void SimpleCCEditor::restorePresetSelection()
@@ -557,7 +1102,7 @@ void SimpleCCEditor::restorePresetSelection()
     }
     else
     {
-        auto presets = getInstrumentPresets();
+        const auto& presets = getInstrumentPresets();
         for (int i = 0; i < (int)presets.size(); ++i)
         {
             if (presets[i].manufacturer == manufacturer && presets[i].name == name)
@@ -568,3 +1113,228 @@ void SimpleCCEditor::restorePresetSelection()
         }
     }
 }
+
+void SimpleCCEditor::rebuildProgramSelector()
+{
+    programSelector.clear(juce::dontSendNotification);
+    
+    for (int i = 0; i < processorRef.getNumPrograms(); ++i)
+        programSelector.addItem(juce::String(i + 1) + ": " + processorRef.getProgramName(i), i + 1);
+    
+    programSelector.setSelectedId(processorRef.getCurrentProgram() + 1, juce::dontSendNotification);
+}
+
+void SimpleCCEditor::exportCapture()
+{
+    static constexpr double captureSeconds = 30.0;
+    
+    auto& capture = processorRef.getOutputCapture();
+    double sampleRate = processorRef.getSampleRate() > 0.0 ? processorRef.getSampleRate() : 44100.0;
+    
+    // Not frozen here: a block already past the frozen check could still be
+    // writing, so a live capture is read with getEvents' safety margin.
+    auto events = capture.getEvents((juce::int64)(captureSeconds * sampleRate));
+    
+    auto file = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                    .getNonexistentChildFile("SimpleCC Capture", ".mid");
+    
+    auto startTime = events.empty() ? 0 : events.front().time;
+    
+    if (OutputCapture::writeMidiFile(events, sampleRate, startTime, file))
+        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::InfoIcon, "Capture exported",
+                                               juce::String((int)events.size()) + " messages written to " + file.getFullPathName());
+    else
+        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Export failed", "Could not write " + file.getFullPathName());
+}
+
+void SimpleCCEditor::programChanged()
+{
+    SIMPLECC_TRACE_SCOPE("SimpleCCEditor::programChanged");
+
+    syncSlotRows();
+    
+    programSelector.setSelectedId(processorRef.getCurrentProgram() + 1, juce::dontSendNotification);
+    programChangeChannelSelector.setSelectedId(processorRef.getProgramChangeChannel() + 2, juce::dontSendNotification);
+}
+
+void SimpleCCEditor::syncSlotRows()
+{
+    for (auto* row : slotRows)
+        row->syncWithProcessor();
+}
+
+void SimpleCCEditor::refreshStateControls()
+{
+    programChangeChannelSelector.setSelectedId(processorRef.getProgramChangeChannel() + 2, juce::dontSendNotification);
+    mergePolicySelector.setSelectedId(processorRef.getDestinationMergePolicy() + 1, juce::dontSendNotification);
+    lookaheadSelector.setSelectedId(processorRef.getLookaheadMs() + 1, juce::dontSendNotification);
+    
+    int resendModeId = processorRef.getRefreshOnTransportStart() ? 2 : 1;
+    for (int id = 3; id <= 5; ++id)
+        if (processorRef.getKeepAliveSeconds() == keepAliveChoices[id - 1])
+            resendModeId = id;
+    resendModeSelector.setSelectedId(resendModeId, juce::dontSendNotification);
+}
+
+// The rows follow their own slot versions; this catches everything else a
+// host-restored state (session load, undo) can change.
+void SimpleCCEditor::timerCallback()
+{
+    auto version = processorRef.getStateVersion();
+    
+    if (version == shownStateVersion)
+        return;
+    
+    SIMPLECC_TRACE_SCOPE("SimpleCCEditor::timerCallback");
+
+    shownStateVersion = version;
+    syncSlotRows();
+    rebuildProgramSelector();
+    refreshStateControls();
+    restorePresetSelection();
+    
+    for (auto* row : macroRows)
+        row->refreshFromProcessor();
+}
+
+void SimpleCCEditor::rebuildSearchIndex()
+{
+    SIMPLECC_TRACE_SCOPE("rebuildSearchIndex");
+
+    searchIndex.clear();
+    
+    const auto& userPresets = processorRef.getUserPresetLibrary();
+    for (int i = 0; i < (int)userPresets.size(); ++i)
+    {
+        const auto& preset = userPresets[i];
+        searchIndex.beginEntry(userPresetStartId + i, preset.manufacturer + " - " + preset.name);
+        
+        for (const auto& slot : preset.slots)
+            searchIndex.addText(slot.name);
+    }
+    
+    for (int i = 0; i < (int)cachedBankPresets.size(); ++i)
+    {
+        auto* bank = processorRef.getPresetBank(cachedBankPresets[i].first);
+        int presetIndex = cachedBankPresets[i].second;
+        
+        if (bank == nullptr)
+            continue;
+        
+        searchIndex.beginEntry(bankPresetStartId + i, bank->getManufacturer(presetIndex) + " - " + bank->getName(presetIndex));
+        
+        for (int slot = 0; slot < bank->getSlotsPerPreset(); ++slot)
+            searchIndex.addText(bank->getSlotNameUTF8(presetIndex, slot));
+    }
+    
+    const auto& presets = getInstrumentPresets();
+    for (int i = 0; i < (int)presets.size(); ++i)
+    {
+        searchIndex.beginEntry(defaultPresetStartId + i, presets[i].manufacturer + " - " + presets[i].name);
+        
+        for (const auto& mapping : presets[i].mappings)
+            searchIndex.addText(mapping.paramName);
+    }
+    
+    searchIndex.build();
+    searchIndexValid = true;
+}
+
+void SimpleCCEditor::updateSearchResults()
+{
+    auto query = searchInput.getText().trim();
+    
+    if (query.isEmpty())
+    {
+        searchResultEntries.clear();
+        searchResults.setVisible(false);
+        return;
+    }
+    
+    if (!searchIndexValid)
+        rebuildSearchIndex();
+    
+    const auto& matches = searchIndex.search(query);
+    searchResultEntries.assign(matches.begin(), matches.end());
+    
+    searchResults.updateContent();
+    searchResults.selectRow(0);
+    searchResults.setVisible(true);
+    searchResults.toFront(false);
+}
+
+void SimpleCCEditor::loadSearchResult(int row)
+{
+    if (row < 0 || row >= (int)searchResultEntries.size())
+        return;
+    
+    int itemId = searchIndex.getItemId(searchResultEntries[row]);
+    
+    searchInput.clear();
+    updateSearchResults();
+    
+    presetSelector.setSelectedId(itemId, juce::sendNotificationSync);
+}
+
+int SimpleCCEditor::getNumRows()
+{
+    return (int)searchResultEntries.size();
+}
+
+void SimpleCCEditor::paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected)
+{
+    if (rowNumber < 0 || rowNumber >= (int)searchResultEntries.size())
+        return;
+    
+    if (rowIsSelected)
+        g.fillAll(juce::Colour(0xff3d5f80));
+    else if (rowNumber % 2 == 0)
+        g.fillAll(juce::Colour(0xff2a2a2a));
+    
+    g.setColour(juce::Colours::white);
+    g.setFont(juce::Font(14.0f, juce::Font::plain));
+    g.drawText(searchIndex.getDisplayText(searchResultEntries[rowNumber]),
+               juce::Rectangle<int>(8, 0, width - 16, height),
+               juce::Justification::centredLeft, true);
+}
+
+void SimpleCCEditor::listBoxItemClicked(int row, const juce::MouseEvent&)
+{
+    loadSearchResult(row);
+}
+
+void SimpleCCEditor::returnKeyPressed(int lastRowSelected)
+{
+    loadSearchResult(lastRowSelected);
+}
+
+void SimpleCCEditor::presetWriteFinished(const juce::File& file, bool succeeded)
+{
+    int libraryIndex = processorRef.finishUserPresetSave(file, succeeded);
+    
+    if (!succeeded)
+    {
+        juce::AlertWindow::showMessageBoxAsync(
+            juce::MessageBoxIconType::WarningIcon,
+            "Save Failed",
+            "The preset could not be written to " + file.getFullPathName() + "."
+        );
+        return;
+    }
+    
+    if (libraryIndex >= 0)
+    {
+        const auto& preset = processorRef.getUserPresetLibrary()[(size_t)libraryIndex];
+        std::pair<juce::String, juce::String> entry { preset.manufacturer, preset.name };
+        
+        if (libraryIndex < (int)cachedUserPresets.size())
+            cachedUserPresets[(size_t)libraryIndex] = entry;
+        else
+            cachedUserPresets.push_back(entry);
+        
+        populatePresetDropdown();
+    }
+    
+    if (processorRef.isUserPreset())
+        selectUserPreset(processorRef.getCurrentPresetManufacturer(), processorRef.getCurrentPresetName());
+}
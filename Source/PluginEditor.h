@@ -2,6 +2,7 @@
 
 #include "PluginProcessor.h"
 #include "InstrumentPresets.h"
+#include "PresetSearchIndex.h"
 
 class MidiActivityIndicator : public juce::Component
 {
@@ -35,6 +36,31 @@ private:
     bool isActive;
 };
 
+// Aggregates the processor's block timings over the last few seconds into
+// median, 99th percentile and worst-case duration plus the share of the
+// real-time budget they use.
+class BlockTimingDisplay : public juce::Component,
+                           private juce::Timer
+{
+public:
+    explicit BlockTimingDisplay(const SimpleCCProcessor& p);
+
+    void paint(juce::Graphics& g) override;
+
+private:
+    void timerCallback() override;
+
+    const SimpleCCProcessor& processor;
+    juce::uint64 readPosition = 0;
+    std::vector<BlockTimingRing::Timing> window;
+    std::vector<BlockTimingRing::Timing> incoming;
+    std::vector<float> sorted;
+    juce::String text;
+    bool nearDeadline = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BlockTimingDisplay)
+};
+
 class SlotRowComponent : public juce::Component,
                          public juce::Timer
 {
@@ -48,21 +74,64 @@ public:
     void timerCallback() override;
     void refreshFromProcessor();
 
+    // Refreshes the row only if the slot's version moved since it was last
+    // shown; returns whether it did.
+    bool syncWithProcessor();
+
 private:
     SimpleCCProcessor& processor;
     int index;
+    juce::uint32 shownVersion = 0;
+    bool showCollision = false;
 
     juce::Label slotNumberLabel;
     juce::ToggleButton enableButton;
+    juce::ComboBox typeSelector;
     juce::TextEditor ccInput;
     juce::ComboBox channelSelector;
+    juce::ComboBox sourceSelector;
+    juce::ComboBox gridSelector;
     juce::TextEditor nameInput;
     MidiActivityIndicator activityIndicator;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SlotRowComponent)
 };
 
-class SimpleCCEditor : public juce::AudioProcessorEditor
+class MacroDestinationRow : public juce::Component
+{
+public:
+    MacroDestinationRow(SimpleCCProcessor& p, int macroIndex, int destinationIndex);
+    ~MacroDestinationRow() override = default;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+    void refreshFromProcessor();
+
+    std::function<void()> onChange;
+
+private:
+    void commit();
+
+    SimpleCCProcessor& processor;
+    int macro;
+    int destination;
+    bool showCollision = false;
+
+    juce::Label destinationLabel;
+    juce::ToggleButton enableButton;
+    juce::TextEditor ccInput;
+    juce::ComboBox channelSelector;
+    juce::TextEditor minInput;
+    juce::TextEditor maxInput;
+    juce::ComboBox curveSelector;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MacroDestinationRow)
+};
+
+class SimpleCCEditor : public juce::AudioProcessorEditor,
+                       public juce::ListBoxModel,
+                       private PresetWriter::Listener,
+                       private juce::Timer
 {
 public:
     explicit SimpleCCEditor(SimpleCCProcessor&);
@@ -76,8 +145,15 @@ public:
     void resetAllSlots();
     void drawLogo(juce::Graphics& g, juce::Rectangle<float> bounds);
     void rebuildPresetDropdown();
+    void populatePresetDropdown();
     void selectUserPreset(const juce::String& manufacturer, const juce::String& name);
     void restorePresetSelection();
+    void programChanged();
+    
+    int getNumRows() override;
+    void paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+    void listBoxItemClicked(int row, const juce::MouseEvent&) override;
+    void returnKeyPressed(int lastRowSelected) override;
 
 private:
     SimpleCCProcessor& processorRef;
@@ -87,21 +163,74 @@ private:
     juce::TextButton saveButton;
     juce::TextButton resetButton;
     
+    juce::TextEditor searchInput;
+    juce::ListBox searchResults;
+    
+    juce::ComboBox programSelector;
+    juce::ComboBox programChangeChannelSelector;
+    
+    juce::Label morphLabel;
+    juce::ComboBox morphModeSelector;
+    juce::OwnedArray<juce::TextButton> snapshotButtons;
+    juce::Slider morphXSlider;
+    juce::Slider morphYSlider;
+    std::unique_ptr<juce::ComboBoxParameterAttachment> morphModeAttachment;
+    std::unique_ptr<juce::SliderParameterAttachment> morphXAttachment;
+    std::unique_ptr<juce::SliderParameterAttachment> morphYAttachment;
+    
+    juce::TextButton macrosButton;
+    juce::OwnedArray<MacroDestinationRow> macroRows;
+    juce::Viewport macroViewport;
+    juce::Component macroContainer;
+    
     juce::Label headerSlot;
+    juce::Label headerType;
     juce::Label headerCC;
     juce::Label headerCh;
+    juce::Label headerSource;
+    juce::Label headerGrid;
     juce::Label headerName;
     juce::Label headerActivity;
     
     juce::Label versionLabel;
+    BlockTimingDisplay timingDisplay;
+    juce::TextButton freezeCaptureButton;
+    juce::TextButton exportCaptureButton;
+
+   #if SIMPLECC_TRACING
+    juce::TextButton traceButton;
+   #endif
+    juce::ComboBox mergePolicySelector;
+    juce::TextButton resendButton;
+    juce::ComboBox resendModeSelector;
+    juce::ComboBox lookaheadSelector;
     
     juce::OwnedArray<SlotRowComponent> slotRows;
     juce::Viewport viewport;
     juce::Component slotContainer;
     
+    juce::uint32 shownStateVersion = 0;
+    
     int userPresetStartId = 2;
     int defaultPresetStartId = 2;
     std::vector<std::pair<juce::String, juce::String>> cachedUserPresets;
+    int bankPresetStartId = 2;
+    std::vector<std::pair<int, int>> cachedBankPresets;
+    
+    PresetSearchIndex searchIndex;
+    bool searchIndexValid = false;
+    std::vector<int> searchResultEntries;
+    
+    void rebuildSearchIndex();
+    void updateSearchResults();
+    void loadSearchResult(int row);
+    void rebuildProgramSelector();
+    void syncSlotRows();
+    void refreshStateControls();
+    void exportCapture();
+    void timerCallback() override;
+    
+    void presetWriteFinished(const juce::File& file, bool succeeded) override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SimpleCCEditor)
 };
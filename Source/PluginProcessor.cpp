@@ -1,5 +1,74 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "RealtimeCheck.h"
+#include "Tracing.h"
+
+namespace
+{
+    juce::uint64 hashStateData(const void* data, size_t size)
+    {
+        auto* bytes = static_cast<const juce::uint8*>(data);
+        juce::uint64 hash = 14695981039346656037ull;
+        
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        
+        return hash;
+    }
+
+    SlotConfig getDefaultSlotConfig(int slot)
+    {
+        SlotConfig config;
+        config.name = "Slot " + juce::String(slot + 1);
+        config.enabled = (slot == 0);
+        return config;
+    }
+
+    // A numbered type needs a number it can send; 14-bit controllers only
+    // exist on 0-31.
+    bool isSendingSlot(const SlotConfig& slot)
+    {
+        return slot.enabled && (!SlotMessage::usesNumber(slot.messageType)
+                                || (slot.ccNumber >= 0 && slot.ccNumber <= SlotMessage::getMaxNumber(slot.messageType)));
+    }
+
+    bool isSameSlotConfig(const SlotConfig& a, const SlotConfig& b)
+    {
+        return a.ccNumber == b.ccNumber && a.midiChannel == b.midiChannel && a.enabled == b.enabled
+            && a.messageType == b.messageType && a.name == b.name;
+    }
+
+    juce::String getDefaultProgramName(int program)
+    {
+        return "Program " + juce::String(program + 1);
+    }
+
+    bool isDefaultProgram(int program, const juce::String& name, const std::array<SlotConfig, NUM_SLOTS>& slots)
+    {
+        if (name != getDefaultProgramName(program))
+            return false;
+
+        for (int i = 0; i < NUM_SLOTS; ++i)
+            if (!isSameSlotConfig(slots[i], getDefaultSlotConfig(i)))
+                return false;
+
+        return true;
+    }
+
+    // The lowest slot in a destination's slot mask, or OutputCapture::noSlot
+    // for destinations only macros feed.
+    int getFirstSlot(juce::uint32 slotMask)
+    {
+        for (int slot = 0; slot < 32; ++slot)
+            if ((slotMask >> slot) & 1)
+                return slot;
+
+        return OutputCapture::noSlot;
+    }
+}
 
 class SlotParameter : public juce::AudioParameterFloat
 {
@@ -51,8 +120,8 @@ SimpleCCProcessor::SimpleCCProcessor()
         slotConfigs[i].ccNumber = -1;
         slotConfigs[i].midiChannel = 1;
         slotConfigs[i].enabled = (i == 0);
-        lastSentValues[i] = -1;
-        slotActivity[i].store(false);
+        slotConfigs[i].messageType = SlotMessage::controlChange;
+        slotGridDivisions[i].store(gridOff);
 
         auto paramId = "slot" + juce::String(i + 1);
         auto paramName = "Slot " + juce::String(i + 1);
@@ -64,29 +133,1027 @@ SimpleCCProcessor::SimpleCCProcessor()
             0.0f
         );
         
-        slotParameters[i] = param;
-        addParameter(param);
+        slotParameters[i] = param;
+        addParameter(param);
+        param->addListener(this);
+    }
+
+    morphModeParameter = new juce::AudioParameterChoice(juce::ParameterID("morphMode", 1), "Morph Mode",
+                                                         juce::StringArray { "Off", "A/B", "XY" }, morphOff);
+    morphXParameter = new juce::AudioParameterFloat(juce::ParameterID("morphX", 1), "Morph X",
+                                                    juce::NormalisableRange<float>(0.0f, 1.0f), 0.0f);
+    morphYParameter = new juce::AudioParameterFloat(juce::ParameterID("morphY", 1), "Morph Y",
+                                                    juce::NormalisableRange<float>(0.0f, 1.0f), 0.0f);
+
+    for (auto* param : std::initializer_list<juce::AudioProcessorParameter*> { morphModeParameter, morphXParameter, morphYParameter })
+    {
+        addParameter(param);
+        param->addListener(this);
+    }
+
+    for (int m = 0; m < NUM_MACROS; ++m)
+    {
+        auto* param = new juce::AudioParameterFloat(juce::ParameterID("macro" + juce::String(m + 1), 1),
+                                                    "Macro " + juce::String(m + 1),
+                                                    juce::NormalisableRange<float>(0.0f, 1.0f), 0.0f);
+        macroParameters[m] = param;
+        addParameter(param);
+        param->addListener(this);
+    }
+
+    for (auto& entry : macroDispatch)
+        entry.store(0);
+    for (auto& entry : statusSourceTable)
+        entry.store(0);
+    for (auto& entry : controllerSourceTable)
+        entry.store(0);
+    resetSentValues();
+
+    for (auto& snapshot : snapshotValues)
+        for (auto& value : snapshot)
+            value.store(0.0f);
+
+    for (int p = 0; p < NUM_PROGRAMS; ++p)
+    {
+        resetProgram(p);
+        compileSlotTable(p, programs[p].slots);
+    }
+
+    activeSlotTable = &compiledTables[0];
+    startTimerHz(30);
+}
+
+SimpleCCProcessor::~SimpleCCProcessor()
+{
+    stopTimer();
+    
+    for (auto* param : slotParameters)
+        param->removeListener(this);
+    
+    morphModeParameter->removeListener(this);
+    morphXParameter->removeListener(this);
+    morphYParameter->removeListener(this);
+    
+    for (auto* param : macroParameters)
+        param->removeListener(this);
+}
+
+void SimpleCCProcessor::parameterValueChanged(int parameterIndex, float newValue)
+{
+    juce::ignoreUnused(parameterIndex, newValue);
+    markConfigChanged();
+}
+
+void SimpleCCProcessor::parameterGestureChanged(int parameterIndex, bool gestureIsStarting)
+{
+    juce::ignoreUnused(parameterIndex, gestureIsStarting);
+}
+
+void SimpleCCProcessor::setSlotEnabled(int slot, bool enabled)
+{
+    if (slot >= 0 && slot < NUM_SLOTS)
+    {
+        slotConfigs[slot].enabled = enabled;
+        slotConfigsChanged();
+    }
+}
+
+void SimpleCCProcessor::setSlotCCNumber(int slot, int ccNumber)
+{
+    if (slot >= 0 && slot < NUM_SLOTS)
+    {
+        slotConfigs[slot].ccNumber = ccNumber;
+        slotConfigsChanged();
+    }
+}
+
+void SimpleCCProcessor::setSlotMessageType(int slot, int messageType)
+{
+    if (slot >= 0 && slot < NUM_SLOTS)
+    {
+        slotConfigs[slot].messageType = juce::jlimit(0, (int)SlotMessage::numTypes - 1, messageType);
+        slotConfigsChanged();
+    }
+}
+
+void SimpleCCProcessor::setSlotMidiChannel(int slot, int midiChannel)
+{
+    if (slot >= 0 && slot < NUM_SLOTS)
+    {
+        slotConfigs[slot].midiChannel = midiChannel;
+        slotConfigsChanged();
+    }
+}
+
+void SimpleCCProcessor::slotConfigsChanged()
+{
+    slotTableDirty = true;
+    markConfigChanged();
+    
+    if (slotUpdateDepth == 0)
+        flushHostNotifications();
+}
+
+void SimpleCCProcessor::updateSlotName(int slot, const juce::String& newName)
+{
+    if (slot >= 0 && slot < NUM_SLOTS)
+    {
+        if (slotConfigs[slot].name == newName)
+            return;
+        
+        slotConfigs[slot].name = newName;
+        markConfigChanged();
+        
+        if (auto* param = dynamic_cast<SlotParameter*>(slotParameters[slot]))
+        {
+            param->setCustomName(newName);
+            parameterInfoChanged = true;
+            
+            if (slotUpdateDepth == 0)
+                flushHostNotifications();
+        }
+    }
+}
+
+void SimpleCCProcessor::setSlotValue(int slot, float value)
+{
+    if (slot < 0 || slot >= NUM_SLOTS)
+        return;
+    
+    if (slotUpdateDepth > 0)
+    {
+        pendingSlotValues[slot] = value;
+        pendingSlotValueMask.set((size_t)slot);
+    }
+    else
+    {
+        slotParameters[slot]->setValueNotifyingHost(value);
+    }
+}
+
+void SimpleCCProcessor::beginSlotUpdate()
+{
+    ++slotUpdateDepth;
+}
+
+void SimpleCCProcessor::endSlotUpdate()
+{
+    jassert(slotUpdateDepth > 0);
+    
+    if (--slotUpdateDepth == 0)
+        flushHostNotifications();
+}
+
+void SimpleCCProcessor::flushHostNotifications()
+{
+    SIMPLECC_TRACE_SCOPE("flushHostNotifications");
+
+    if (slotTableDirty)
+    {
+        slotTableDirty = false;
+        compileSlotTable(currentProgram, slotConfigs);
+        rebuildDestinationIndex();
+    }
+    
+    if (pendingSlotValueMask.any())
+    {
+        for (int i = 0; i < NUM_SLOTS; ++i)
+        {
+            if (pendingSlotValueMask.test((size_t)i) && slotParameters[i]->getValue() != pendingSlotValues[i])
+                slotParameters[i]->setValueNotifyingHost(pendingSlotValues[i]);
+        }
+        
+        pendingSlotValueMask.reset();
+    }
+    
+    for (int i = 0; i < numPendingParameterValues; ++i)
+    {
+        auto& parameter = *pendingParameterValues[(size_t)i].first;
+        auto normalized = parameter.convertTo0to1(pendingParameterValues[(size_t)i].second);
+        
+        if (parameter.getValue() != normalized)
+            parameter.setValueNotifyingHost(normalized);
+    }
+    
+    numPendingParameterValues = 0;
+    
+    if (parameterInfoChanged || programChanged)
+    {
+        auto details = juce::AudioProcessor::ChangeDetails()
+            .withParameterInfoChanged(parameterInfoChanged)
+            .withProgramChanged(programChanged);
+        
+        parameterInfoChanged = false;
+        programChanged = false;
+        updateHostDisplay(details);
+    }
+    
+    publishSlotVersions();
+}
+
+void SimpleCCProcessor::setParameterValue(juce::RangedAudioParameter& parameter, float value)
+{
+    if (slotUpdateDepth == 0)
+    {
+        parameter.setValueNotifyingHost(parameter.convertTo0to1(value));
+        return;
+    }
+    
+    for (int i = 0; i < numPendingParameterValues; ++i)
+    {
+        if (pendingParameterValues[(size_t)i].first == &parameter)
+        {
+            pendingParameterValues[(size_t)i].second = value;
+            return;
+        }
+    }
+    
+    jassert(numPendingParameterValues < maxPendingParameterValues);
+    pendingParameterValues[(size_t)numPendingParameterValues++] = { &parameter, value };
+}
+
+void SimpleCCProcessor::publishSlotVersions()
+{
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        auto& published = publishedSlots[i];
+        int division = slotGridDivisions[i].load();
+        
+        if (isSameSlotConfig(published.config, slotConfigs[i])
+            && published.source.type == slotSources[i].type
+            && published.source.ccNumber == slotSources[i].ccNumber
+            && published.gridDivision == division)
+            continue;
+        
+        published.config = slotConfigs[i];
+        published.source = slotSources[i];
+        published.gridDivision = division;
+        slotVersions[i].fetch_add(1, std::memory_order_release);
+    }
+}
+
+void SimpleCCProcessor::compileSlotTable(int program, const std::array<SlotConfig, NUM_SLOTS>& slots)
+{
+    auto& entries = compiledTables[program].entries;
+    
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        const auto& slot = slots[i];
+        juce::uint32 packed = 0;
+        
+        if (isSendingSlot(slot))
+        {
+            packed = 0x10000u
+                   | ((juce::uint32)slot.messageType << 20)
+                   | ((juce::uint32)(juce::jlimit(1, 16, slot.midiChannel) - 1) << 8)
+                   | (juce::uint32)(juce::jmax(0, slot.ccNumber) & 0x7f);
+        }
+        
+        entries[i].store(packed, std::memory_order_release);
+    }
+}
+
+void SimpleCCProcessor::resetProgram(int program)
+{
+    programs[program].name = getDefaultProgramName(program);
+    
+    for (int i = 0; i < NUM_SLOTS; ++i)
+        programs[program].slots[i] = getDefaultSlotConfig(i);
+}
+
+void SimpleCCProcessor::switchToProgram(int index)
+{
+    if (index < 0 || index >= NUM_PROGRAMS || index == currentProgram)
+        return;
+    
+    {
+        ScopedSlotUpdate update(*this);
+        
+        if (slotTableDirty)
+        {
+            slotTableDirty = false;
+            compileSlotTable(currentProgram, slotConfigs);
+        }
+        
+        slotTableDirty = true;
+        programs[currentProgram].slots = slotConfigs;
+        currentProgram = index;
+        
+        const auto& program = programs[index];
+        
+        for (int i = 0; i < NUM_SLOTS; ++i)
+        {
+            slotConfigs[i].ccNumber = program.slots[i].ccNumber;
+            slotConfigs[i].midiChannel = program.slots[i].midiChannel;
+            slotConfigs[i].enabled = program.slots[i].enabled;
+            slotConfigs[i].messageType = program.slots[i].messageType;
+            updateSlotName(i, program.slots[i].name);
+        }
+        
+        programChanged = true;
+        markConfigChanged();
+    }
+    
+    if (auto* editor = dynamic_cast<SimpleCCEditor*>(getActiveEditor()))
+        editor->programChanged();
+}
+
+void SimpleCCProcessor::setProgramChangeChannel(int channel)
+{
+    programChangeChannel.store(juce::jlimit(-1, 16, channel));
+    markConfigChanged();
+}
+
+void SimpleCCProcessor::captureSnapshot(int snapshot)
+{
+    if (snapshot < 0 || snapshot >= NUM_SNAPSHOTS)
+        return;
+    
+    for (int i = 0; i < NUM_SLOTS; ++i)
+        snapshotValues[snapshot][i].store(slotParameters[i]->get());
+    
+    markConfigChanged();
+}
+
+void SimpleCCProcessor::computeMorphedValues(int mode)
+{
+    float x = morphXParameter->get();
+    float y = (mode == morphXY) ? morphYParameter->get() : 0.0f;
+    
+    const float weights[NUM_SNAPSHOTS] = { (1.0f - x) * (1.0f - y), x * (1.0f - y), (1.0f - x) * y, x * y };
+    
+    juce::FloatVectorOperations::clear(slotOutputValues.data(), NUM_SLOTS);
+    
+    for (int s = 0; s < NUM_SNAPSHOTS; ++s)
+    {
+        if (weights[s] == 0.0f)
+            continue;
+        
+        auto& values = snapshotScratch[s];
+        for (int i = 0; i < NUM_SLOTS; ++i)
+            values[i] = snapshotValues[s][i].load(std::memory_order_relaxed);
+        
+        juce::FloatVectorOperations::addWithMultiply(slotOutputValues.data(), values.data(), weights[s], NUM_SLOTS);
+    }
+}
+
+void SimpleCCProcessor::setMacroDestination(int macro, int destination, const MacroDestination& newDestination)
+{
+    if (macro < 0 || macro >= NUM_MACROS || destination < 0 || destination >= MACRO_DESTINATIONS)
+        return;
+    
+    macroDestinations[macro][destination] = newDestination;
+    rebuildMacroDispatch();
+    markConfigChanged();
+}
+
+void SimpleCCProcessor::rebuildMacroDispatch()
+{
+    std::array<juce::uint32, maxMacroDispatch> previous;
+    int previousCount = numMacroDispatch.load(std::memory_order_relaxed);
+    
+    for (int k = 0; k < previousCount; ++k)
+        previous[k] = macroDispatch[k].load(std::memory_order_relaxed);
+    
+    // Entries the audio thread hasn't acknowledged yet must survive.
+    bool acknowledged = macroDispatchVersionSeen.load(std::memory_order_acquire) == macroDispatchVersion.load();
+    int numResets = acknowledged ? 0 : numMacroKeyResets.load(std::memory_order_relaxed);
+    int count = 0;
+    
+    for (int m = 0; m < NUM_MACROS; ++m)
+    {
+        for (const auto& destination : macroDestinations[m])
+        {
+            if (!destination.enabled || destination.ccNumber < 0)
+                continue;
+            
+            auto packed = (juce::uint32)(destination.ccNumber & 0x7f)
+                        | ((juce::uint32)(juce::jlimit(1, 16, destination.midiChannel) - 1) << 8)
+                        | ((juce::uint32)(juce::jlimit(0, 3, destination.curve)) << 12)
+                        | ((juce::uint32)m << 14)
+                        | ((juce::uint32)juce::jlimit(0, 127, destination.minValue) << 16)
+                        | ((juce::uint32)juce::jlimit(0, 127, destination.maxValue) << 24);
+            
+            macroDispatch[count++].store(packed, std::memory_order_relaxed);
+            
+            if (numResets > maxMacroKeyResets
+                || std::find(previous.begin(), previous.begin() + previousCount, packed) != previous.begin() + previousCount)
+                continue;
+            
+            auto key = (juce::uint16)getMacroDestinationKey(packed);
+            bool queued = false;
+            
+            for (int r = 0; r < numResets && !queued; ++r)
+                queued = macroKeyResets[r].load(std::memory_order_relaxed) == key;
+            
+            if (queued)
+                continue;
+            
+            if (numResets < maxMacroKeyResets)
+                macroKeyResets[numResets].store(key, std::memory_order_relaxed);
+            
+            ++numResets;
+        }
+    }
+    
+    numMacroDispatch.store(count, std::memory_order_release);
+    numMacroKeyResets.store(numResets, std::memory_order_release);
+    macroDispatchVersion.fetch_add(1, std::memory_order_release);
+    rebuildDestinationIndex();
+}
+
+void SimpleCCProcessor::setDestinationMergePolicy(int policy)
+{
+    destinationMergePolicy.store(juce::jlimit((int)mergeLastWins, (int)mergeWarn, policy));
+    markConfigChanged();
+}
+
+void SimpleCCProcessor::rebuildDestinationIndex()
+{
+    std::array<juce::uint8, numDestinationKeys> users {};
+    
+    auto keyOf = [](int type, int channel, int number) { return SlotMessage::getDestinationKey(type, juce::jlimit(1, 16, channel), number); };
+    
+    for (const auto& slot : slotConfigs)
+        if (isSendingSlot(slot))
+            ++users[keyOf(slot.messageType, slot.midiChannel, slot.ccNumber)];
+    
+    for (const auto& macro : macroDestinations)
+        for (const auto& destination : macro)
+            if (destination.enabled && destination.ccNumber >= 0)
+                ++users[keyOf(SlotMessage::controlChange, destination.midiChannel, destination.ccNumber)];
+    
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        const auto& slot = slotConfigs[i];
+        slotCollisions.set((size_t)i, isSendingSlot(slot) && users[keyOf(slot.messageType, slot.midiChannel, slot.ccNumber)] > 1);
+    }
+    
+    for (int m = 0; m < NUM_MACROS; ++m)
+    {
+        for (int d = 0; d < MACRO_DESTINATIONS; ++d)
+        {
+            const auto& destination = macroDestinations[m][d];
+            macroCollisions.set((size_t)(m * MACRO_DESTINATIONS + d),
+                                destination.enabled && destination.ccNumber >= 0
+                                    && users[keyOf(SlotMessage::controlChange, destination.midiChannel, destination.ccNumber)] > 1);
+        }
+    }
+}
+
+int SimpleCCProcessor::getSlotDestinationKey(juce::uint32 packed)
+{
+    return SlotMessage::getDestinationKey((int)((packed >> 20) & 0x07), (int)((packed >> 8) & 0x0f) + 1, (int)(packed & 0x7f));
+}
+
+int SimpleCCProcessor::getMacroDestinationKey(juce::uint32 packed)
+{
+    return SlotMessage::getDestinationKey(SlotMessage::controlChange, (int)((packed >> 8) & 0x0f) + 1, (int)(packed & 0x7f));
+}
+
+void SimpleCCProcessor::sendDestination(juce::MidiBuffer& midiMessages, int key, int value, int samplePosition, int slot)
+{
+    int type, channel, number;
+    SlotMessage::decodeDestinationKey(key, type, channel, number);
+    
+    juce::uint8 bytes[SlotMessage::maxEncodedSize];
+    int size = SlotMessage::encode(type, channel, number, value, bytes);
+    
+    // Only a 14-bit controller encodes to more than one message, two
+    // three-byte control changes.
+    for (int start = 0; start < size; start += 3)
+    {
+        int messageSize = juce::jmin(3, size - start);
+        midiMessages.addEvent(bytes + start, messageSize, samplePosition);
+        outputCapture.record(blockStartTime + samplePosition, slot, bytes + start, messageSize);
+    }
+}
+
+bool SimpleCCProcessor::sendDestinationValue(juce::MidiBuffer& midiMessages, int key, float normalizedValue, int samplePosition, int slot)
+{
+    int type, channel, number;
+    SlotMessage::decodeDestinationKey(key, type, channel, number);
+    
+    int maxValue = SlotMessage::getMaxValue(type);
+    int value = juce::jlimit(0, maxValue, juce::roundToInt(normalizedValue * (float)maxValue));
+    auto& destination = destinationKeys[key];
+    
+    if (value == destination.lastSentValue)
+        return false;
+    
+    destination.lastSentValue = value;
+    sendDestination(midiMessages, key, value, samplePosition, slot);
+    return true;
+}
+
+void SimpleCCProcessor::resetSentValues()
+{
+    for (auto& destination : destinationKeys)
+        destination.lastSentValue = -1;
+    
+    sysexRecallPending.store(true);
+}
+
+void SimpleCCProcessor::updateSysExDump()
+{
+    SysExDump rendered;
+    
+    if (!isCurrentPresetUser)
+    {
+        for (const auto& preset : getInstrumentPresets())
+        {
+            if (preset.manufacturer == currentPresetManufacturer && preset.name == currentPresetName)
+            {
+                rendered.render(preset.sysex, NUM_SLOTS);
+                break;
+            }
+        }
+    }
+    
+    {
+        const juce::SpinLock::ScopedLockType lock(sysexLock);
+        std::swap(sysexDump, rendered);
+    }
+    
+    sysexRecallPending.store(true);
+}
+
+juce::uint32 SimpleCCProcessor::sendSysExDump(juce::MidiBuffer& midiMessages, int samplePosition, int& numBytes)
+{
+    numBytes = 0;
+    
+    // The message thread only holds the lock to swap in a new rendering; if
+    // that is happening right now, this recall goes out as individual messages.
+    const juce::SpinLock::ScopedTryLockType lock(sysexLock);
+    
+    if (!lock.isLocked() || sysexDump.isEmpty())
+        return 0;
+    
+    const auto& entries = activeSlotTable->entries;
+    auto midiSourced = midiSourcedSlots.load();
+    auto dumpSlots = sysexDump.getSlotMask();
+    juce::uint32 covered = 0;
+    
+    // A slot only rides in the dump while it still sends to the destination
+    // its byte was written for; one that was moved to another CC, type or
+    // channel since the preset loaded goes out as its own message instead.
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        if (((dumpSlots >> i) & 1) == 0)
+            continue;
+        
+        auto packed = entries[i].load(std::memory_order_acquire);
+        
+        if (packed == 0 || ((midiSourced >> i) & 1) != 0
+            || getSlotDestinationKey(packed) != sysexDump.getSlotDestinationKey(i))
+        {
+            sysexDump.resetSlotValue(i);
+            continue;
+        }
+        
+        sysexDump.setSlotValue(i, slotOutputValues[i]);
+        
+        int key = getSlotDestinationKey(packed);
+        int maxValue = SlotMessage::getMaxValue((int)((packed >> 20) & 0x07));
+        destinationKeys[key].lastSentValue = juce::jlimit(0, maxValue, juce::roundToInt(slotOutputValues[i] * (float)maxValue));
+        covered |= 1u << i;
+    }
+    
+    // Nothing left for the dump to recall.
+    if (dumpSlots != 0 && covered == 0)
+        return 0;
+    
+    sysexDump.updateChecksum();
+    midiMessages.addEvent(sysexDump.getData(), sysexDump.getSize(), samplePosition);
+    outputCapture.record(blockStartTime + samplePosition, OutputCapture::noSlot, sysexDump.getData(), sysexDump.getSize());
+    numBytes = sysexDump.getSize();
+    return covered;
+}
+
+void SimpleCCProcessor::addDestinationValue(int key, float value, juce::uint32 slotMask, int samplePosition)
+{
+    auto& destination = destinationKeys[key];
+    
+    if (destination.stamp != mergeStamp)
+    {
+        destination.stamp = mergeStamp;
+        destination.entry = numMergedDestinations;
+        mergedDestinations[numMergedDestinations++] = { key, value, value, value, 1, slotMask, samplePosition, false };
+        return;
+    }
+    
+    auto& entry = mergedDestinations[destination.entry];
+    entry.slotMask |= slotMask;
+    
+    if (entry.count++ == 0)
+    {
+        entry.sum = entry.maximum = entry.last = value;
+        entry.samplePosition = samplePosition;
+        return;
+    }
+    
+    entry.sum += value;
+    entry.maximum = juce::jmax(entry.maximum, value);
+    entry.last = value;
+    entry.samplePosition = juce::jmax(entry.samplePosition, samplePosition);
+}
+
+void SimpleCCProcessor::addHeldDestination(int key, juce::uint32 slotMask)
+{
+    auto& destination = destinationKeys[key];
+    
+    if (destination.stamp != mergeStamp)
+    {
+        destination.stamp = mergeStamp;
+        destination.entry = numMergedDestinations;
+        mergedDestinations[numMergedDestinations++] = { key, 0.0f, 0.0f, 0.0f, 0, slotMask, 0, false };
+        return;
+    }
+    
+    mergedDestinations[destination.entry].slotMask |= slotMask;
+}
+
+void SimpleCCProcessor::emitMergedDestinations(juce::MidiBuffer& midiMessages)
+{
+    int policy = destinationMergePolicy.load();
+    
+    for (int i = 0; i < numMergedDestinations; ++i)
+    {
+        auto& entry = mergedDestinations[i];
+        float value = entry.last;
+        
+        if (entry.count > 1)
+        {
+            if (policy == mergeMax)
+                value = entry.maximum;
+            else if (policy == mergeAverage)
+                value = entry.sum / (float)entry.count;
+        }
+        
+        if (entry.count == 0 || !sendDestinationValue(midiMessages, entry.key, value, entry.samplePosition, getFirstSlot(entry.slotMask)))
+            continue;
+        
+        entry.sent = true;
+        
+        blockActivity |= entry.slotMask;
+    }
+}
+
+void SimpleCCProcessor::setRefreshOnTransportStart(bool shouldRefresh)
+{
+    refreshOnTransportStart.store(shouldRefresh);
+    markConfigChanged();
+}
+
+void SimpleCCProcessor::setKeepAliveSeconds(int seconds)
+{
+    keepAliveSeconds.store(juce::jlimit(0, 3600, seconds));
+    markConfigChanged();
+}
+
+void SimpleCCProcessor::setLookaheadMs(int ms)
+{
+    lookaheadMs.store(juce::jlimit(0, 100, ms));
+    updateLookaheadLatency();
+    markConfigChanged();
+}
+
+void SimpleCCProcessor::updateLookaheadLatency()
+{
+    int samples = juce::roundToInt(lookaheadMs.load() * currentSampleRate / 1000.0);
+    lookaheadSamples.store(samples);
+    setLatencySamples(samples);
+}
+
+void SimpleCCProcessor::delayIncomingMidi(juce::MidiBuffer& midiMessages, int numSamples)
+{
+    int delay = lookaheadSamples.load();
+    
+    // Events queued under another delay go out now, in order and ahead of
+    // this block's input, so that nothing delayed by the new amount (or not
+    // at all) overtakes them.
+    bool flush = delay != appliedLookaheadSamples && !midiDelay.isEmpty();
+    appliedLookaheadSamples = delay;
+    
+    if (delay > 0 || flush)
+    {
+        incomingScratch.swapWith(midiMessages);
+        
+        if (flush)
+            midiDelay.flush(midiMessages, 0);
+        
+        for (const auto metadata : incomingScratch)
+        {
+            // If the delay line is full the event passes through undelayed
+            // rather than being dropped.
+            if (delay == 0 || !midiDelay.push(sampleClock + metadata.samplePosition + delay, metadata.data, metadata.numBytes))
+                midiMessages.addEvent(metadata.data, metadata.numBytes, metadata.samplePosition);
+        }
+        
+        incomingScratch.clear();
+    }
+    
+    if (!midiDelay.isEmpty())
+        midiDelay.popDue(sampleClock, sampleClock + numSamples, midiMessages);
+    
+    sampleClock += numSamples;
+}
+
+void SimpleCCProcessor::setSlotSource(int slot, const SlotSource& source)
+{
+    if (slot < 0 || slot >= NUM_SLOTS)
+        return;
+    
+    slotSources[slot].type = juce::jlimit((int)sourceParameter, (int)sourceController, source.type);
+    slotSources[slot].ccNumber = juce::jlimit(0, 127, source.ccNumber);
+    rebuildSourceTables();
+    markConfigChanged();
+    
+    if (slotUpdateDepth == 0)
+        flushHostNotifications();
+}
+
+void SimpleCCProcessor::rebuildSourceTables()
+{
+    std::array<juce::uint32, 128> statusMasks {};
+    std::array<juce::uint32, 128> controllerMasks {};
+    juce::uint32 sourced = 0;
+    
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        const auto& source = slotSources[i];
+        
+        for (int channel = 0; channel < 16; ++channel)
+        {
+            switch (source.type)
+            {
+                case sourceVelocity:        statusMasks[0x10 + channel] |= 1u << i; break;
+                case sourceNoteNumber:      statusMasks[0x10 + channel] |= 1u << (i + 16); break;
+                case sourceChannelPressure: statusMasks[0x50 + channel] |= 1u << i; break;
+                default: break;
+            }
+        }
+        
+        if (source.type == sourceController)
+            controllerMasks[source.ccNumber] |= 1u << i;
+        
+        if (source.type != sourceParameter)
+            sourced |= 1u << i;
+    }
+    
+    for (int i = 0; i < 128; ++i)
+    {
+        statusSourceTable[i].store(statusMasks[i], std::memory_order_relaxed);
+        controllerSourceTable[i].store(controllerMasks[i], std::memory_order_relaxed);
+    }
+    
+    midiSourcedSlots.store(sourced);
+}
+
+void SimpleCCProcessor::scanIncomingMidi(const juce::MidiBuffer& midiMessages)
+{
+    int receiveChannel = programChangeChannel.load();
+    numModulationEvents = 0;
+    
+    for (const auto metadata : midiMessages)
+    {
+        const auto* data = metadata.data;
+        auto status = data[0];
+        
+        if (metadata.numBytes < 2 || status < 0x80 || status >= 0xf0)
+            continue;
+        
+        if ((status & 0xf0) == 0xc0)
+        {
+            if (receiveChannel >= 0 && (receiveChannel == 0 || (status & 0x0f) + 1 == receiveChannel))
+            {
+                int program = data[1] & 0x7f;
+                activeSlotTable = &compiledTables[program];
+                programChangeFromMidi.store(program);
+                resetSentValues();
+            }
+            
+            continue;
+        }
+        
+        auto sources = (status & 0xf0) == 0xb0 ? controllerSourceTable[data[1] & 0x7f].load(std::memory_order_relaxed)
+                                               : statusSourceTable[status - 0x80].load(std::memory_order_relaxed);
+        
+        if (sources == 0)
+            continue;
+        
+        // Channel pressure carries its value in the first data byte, everything
+        // else used here in the second. A note-on with velocity 0 is a note-off.
+        bool isPressure = (status & 0xf0) == 0xd0;
+        
+        if (!isPressure && (metadata.numBytes < 3 || ((status & 0xf0) == 0x90 && data[2] == 0)))
+            continue;
+        
+        int value = isPressure ? data[1] : data[2];
+        
+        for (int slot = 0; slot < NUM_SLOTS && numModulationEvents < maxModulationEvents; ++slot)
+        {
+            if ((sources >> slot) & 1)
+                modulationEvents[numModulationEvents++] = { metadata.samplePosition, slot, value & 0x7f };
+            
+            if (((sources >> (slot + 16)) & 1) && numModulationEvents < maxModulationEvents)
+                modulationEvents[numModulationEvents++] = { metadata.samplePosition, slot, data[1] & 0x7f };
+        }
+    }
+}
+
+void SimpleCCProcessor::emitModulationEvents(juce::MidiBuffer& midiMessages)
+{
+    const auto& entries = activeSlotTable->entries;
+    
+    for (int i = 0; i < numModulationEvents; ++i)
+    {
+        const auto& event = modulationEvents[i];
+        auto packed = entries[event.slot].load(std::memory_order_acquire);
+        
+        if (packed == 0)
+            continue;
+        
+        if (sendDestinationValue(midiMessages, getSlotDestinationKey(packed), (float)event.value / 127.0f, event.samplePosition, event.slot))
+            blockActivity |= 1u << event.slot;
+    }
+}
+
+void SimpleCCProcessor::setSlotGridDivision(int slot, int division)
+{
+    if (slot < 0 || slot >= NUM_SLOTS)
+        return;
+    
+    slotGridDivisions[slot].store(juce::jlimit((int)gridOff, (int)gridBar, division));
+    markConfigChanged();
+    
+    if (slotUpdateDepth == 0)
+        flushHostNotifications();
+}
+
+void SimpleCCProcessor::readTransport(int numSamples)
+{
+    wasPlaying = isPlaying;
+    isPlaying = false;
+    gridReleaseOffsets.fill(-1);
+    
+    auto* playHead = getPlayHead();
+    if (playHead == nullptr)
+        return;
+    
+    auto position = playHead->getPosition();
+    if (!position)
+        return;
+    
+    isPlaying = position->getIsPlaying();
+    
+    auto ppq = position->getPpqPosition();
+    auto bpm = position->getBpm();
+    
+    if (!isPlaying || !ppq || !bpm || *bpm <= 0.0)
+        return;
+    
+    auto timeSignature = position->getTimeSignature().orFallback({});
+    double barStart = position->getPpqPositionOfLastBarStart().orFallback(0.0);
+    double samplesPerQuarter = currentSampleRate * 60.0 / *bpm;
+    double blockEnd = *ppq + numSamples / samplesPerQuarter;
+    
+    const double gridLengths[numGridDivisions] = {
+        0.0, 0.25, 0.5, 1.0, 2.0,
+        4.0 * timeSignature.numerator / juce::jmax(1, timeSignature.denominator)
+    };
+    
+    for (int division = grid16th; division < numGridDivisions; ++division)
+    {
+        double length = gridLengths[division];
+        double next = barStart + std::ceil((*ppq - barStart) / length - 1.0e-9) * length;
+        
+        if (next < blockEnd)
+            gridReleaseOffsets[division] = juce::jlimit(0, numSamples - 1, juce::roundToInt((next - *ppq) * samplesPerQuarter));
     }
 }
 
-SimpleCCProcessor::~SimpleCCProcessor()
+void SimpleCCProcessor::processRefresh(juce::MidiBuffer& midiMessages, int numSamples)
 {
+    bool start = refreshRequested.exchange(false);
+    
+    if (refreshOnTransportStart.load() && isPlaying && !wasPlaying)
+        start = true;
+    
+    int keepAlive = keepAliveSeconds.load();
+    
+    if (keepAlive > 0)
+    {
+        samplesSinceRefresh += numSamples;
+        
+        if ((double)samplesSinceRefresh >= keepAlive * currentSampleRate)
+            start = true;
+    }
+    
+    if (start)
+    {
+        refreshActive = true;
+        refreshIndex = 0;
+        refreshCountdown = 0.0;
+        samplesSinceRefresh = 0;
+        
+        int dumpSize = 0;
+        refreshSysExSlots = sendSysExDump(midiMessages, 0, dumpSize);
+        refreshCountdown += currentSampleRate * dumpSize / refreshBytesPerSecond;
+    }
+    
+    if (!refreshActive)
+        return;
+    
+    double samplesPerMessage = currentSampleRate * 3.0 / refreshBytesPerSecond;
+    
+    while (refreshCountdown < (double)numSamples)
+    {
+        if (refreshIndex >= numMergedDestinations)
+        {
+            refreshActive = false;
+            return;
+        }
+        
+        const auto& entry = mergedDestinations[refreshIndex++];
+        
+        // Destinations that changed this block have just been sent anyway.
+        const auto& destination = destinationKeys[entry.key];
+        
+        if (entry.sent || destination.lastSentValue < 0)
+            continue;
+        
+        // Slot destinations carried by the SysEx dump were resent with it.
+        if (entry.slotMask != 0 && (entry.slotMask & ~refreshSysExSlots) == 0)
+            continue;
+        
+        sendDestination(midiMessages, entry.key, destination.lastSentValue, (int)refreshCountdown, getFirstSlot(entry.slotMask));
+        refreshCountdown += samplesPerMessage;
+    }
+    
+    refreshCountdown -= (double)numSamples;
 }
 
-void SimpleCCProcessor::updateSlotName(int slot, const juce::String& newName)
+void SimpleCCProcessor::processMacros()
 {
-    if (slot >= 0 && slot < NUM_SLOTS)
+    auto version = macroDispatchVersion.load(std::memory_order_acquire);
+    
+    // Only destinations that are new or changed resend straight away.
+    if (version != lastMacroDispatchVersion)
     {
-        slotConfigs[slot].name = newName;
+        lastMacroDispatchVersion = version;
+        int numResets = numMacroKeyResets.load(std::memory_order_acquire);
         
-        if (auto* param = dynamic_cast<SlotParameter*>(slotParameters[slot]))
+        if (numResets > maxMacroKeyResets)
         {
-            param->setCustomName(newName);
-            updateHostDisplay(juce::AudioProcessor::ChangeDetails().withParameterInfoChanged(true));
+            for (auto& destination : destinationKeys)
+                destination.lastSentValue = -1;
+        }
+        else
+        {
+            for (int r = 0; r < numResets; ++r)
+                destinationKeys[macroKeyResets[r].load(std::memory_order_relaxed)].lastSentValue = -1;
+        }
+        
+        macroDispatchVersionSeen.store(version, std::memory_order_release);
+    }
+    
+    float macroValues[NUM_MACROS];
+    for (int m = 0; m < NUM_MACROS; ++m)
+        macroValues[m] = macroParameters[m]->get();
+    
+    int count = numMacroDispatch.load(std::memory_order_acquire);
+    
+    for (int k = 0; k < count; ++k)
+    {
+        auto packed = macroDispatch[k].load(std::memory_order_relaxed);
+        float value = macroValues[(packed >> 14) & 0x03];
+        
+        switch ((packed >> 12) & 0x03)
+        {
+            case macroCurveExponential: value = value * value; break;
+            case macroCurveLogarithmic: value = std::sqrt(value); break;
+            default: break;
         }
+        
+        int minValue = (int)((packed >> 16) & 0x7f);
+        int maxValue = (int)((packed >> 24) & 0x7f);
+        addDestinationValue(getMacroDestinationKey(packed), ((float)minValue + value * (float)(maxValue - minValue)) / 127.0f, 0);
     }
 }
 
+void SimpleCCProcessor::timerCallback()
+{
+    SIMPLECC_TRACE_SCOPE("SimpleCCProcessor::timerCallback");
+
+    // The audio thread has already switched tables for a MIDI program change;
+    // bring the editable slots and the host in line with it.
+    auto program = programChangeFromMidi.exchange(-1);
+    
+    if (program >= 0)
+        switchToProgram(program);
+}
+
 const juce::String SimpleCCProcessor::getName() const
 {
     return JucePlugin_Name;
@@ -114,36 +1181,52 @@ double SimpleCCProcessor::getTailLengthSeconds() const
 
 int SimpleCCProcessor::getNumPrograms()
 {
-    return 1;
+    return NUM_PROGRAMS;
 }
 
 int SimpleCCProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram;
 }
 
 void SimpleCCProcessor::setCurrentProgram(int index)
 {
-    juce::ignoreUnused(index);
+    if (index < 0 || index >= NUM_PROGRAMS)
+        return;
+    
+    switchToProgram(index);
+    pendingProgram.store(index);
 }
 
 const juce::String SimpleCCProcessor::getProgramName(int index)
 {
-    juce::ignoreUnused(index);
-    return {};
+    if (index < 0 || index >= NUM_PROGRAMS)
+        return {};
+    
+    return programs[index].name;
 }
 
 void SimpleCCProcessor::changeProgramName(int index, const juce::String& newName)
 {
-    juce::ignoreUnused(index, newName);
+    if (index < 0 || index >= NUM_PROGRAMS || programs[index].name == newName)
+        return;
+    
+    programs[index].name = newName;
+    markConfigChanged();
 }
 
 void SimpleCCProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    juce::ignoreUnused(sampleRate, samplesPerBlock);
+    juce::ignoreUnused(samplesPerBlock);
     
-    for (int i = 0; i < NUM_SLOTS; ++i)
-        lastSentValues[i] = -1;
+    currentSampleRate = sampleRate;
+    updateLookaheadLatency();
+    
+    midiDelay.prepare(midiDelayCapacity);
+    incomingScratch.ensureSize(midiDelayCapacity);
+    sampleClock = 0;
+    
+    resetSentValues();
 }
 
 void SimpleCCProcessor::releaseResources()
@@ -159,32 +1242,85 @@ bool SimpleCCProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
 void SimpleCCProcessor::processBlock(juce::AudioBuffer<float>& buffer,
                                       juce::MidiBuffer& midiMessages)
 {
+    SIMPLECC_REALTIME_SCOPE;
+    SIMPLECC_TRACE_SCOPE("processBlock");
+    
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    
     buffer.clear();
+    readTransport(buffer.getNumSamples());
     
     // Don't clear midiMessages - we want to pass MIDI through!
     // Just add our CC messages to the existing MIDI
 
+    // A program switch only swaps the table pointer. Every slot resends its
+    // value afterwards so the new destinations start from the current state.
+    int program = pendingProgram.exchange(-1);
+    
+    if (program >= 0)
+    {
+        activeSlotTable = &compiledTables[program];
+        resetSentValues();
+    }
+    
+    blockStartTime = sampleClock;
+    blockActivity = 0;
+    scanIncomingMidi(midiMessages);
+    delayIncomingMidi(midiMessages, buffer.getNumSamples());
+    emitModulationEvents(midiMessages);
+    
+    int morphMode = morphModeParameter->getIndex();
+    
+    if (morphMode == morphOff)
+    {
+        for (int i = 0; i < NUM_SLOTS; ++i)
+            slotOutputValues[i] = slotParameters[i]->get();
+    }
+    else
+    {
+        computeMorphedValues(morphMode);
+    }
+    
+    // A recall sends the preset's SysEx dump, if it has one, in place of one
+    // message per slot; the slots it covers then dedupe against it below.
+    if (sysexRecallPending.exchange(false))
+    {
+        int dumpSize = 0;
+        sendSysExDump(midiMessages, 0, dumpSize);
+    }
+    
+    const auto& entries = activeSlotTable->entries;
+    auto midiSourced = midiSourcedSlots.load();
+    
+    ++mergeStamp;
+    numMergedDestinations = 0;
+
     for (int i = 0; i < NUM_SLOTS; ++i)
     {
-        if (!slotConfigs[i].enabled || slotConfigs[i].ccNumber < 0)
+        auto packed = entries[i].load(std::memory_order_acquire);
+        
+        if (packed == 0 || ((midiSourced >> i) & 1) != 0)
             continue;
-
-        float value = slotParameters[i]->get();
-        int ccValue = juce::roundToInt(value * 127.0f);
         
-        if (ccValue != lastSentValues[i])
-        {
-            lastSentValues[i] = ccValue;
-            
-            int channel = slotConfigs[i].midiChannel;
-            int ccNumber = slotConfigs[i].ccNumber;
-            
-            auto message = juce::MidiMessage::controllerEvent(channel, ccNumber, ccValue);
-            midiMessages.addEvent(message, 0);
-            
-            slotActivity[i].store(true);
-        }
+        int division = slotGridDivisions[i].load(std::memory_order_relaxed);
+        int offset = (division != gridOff && isPlaying) ? gridReleaseOffsets[division] : 0;
+        
+        if (offset < 0)
+            addHeldDestination(getSlotDestinationKey(packed), 1u << i);
+        else
+            addDestinationValue(getSlotDestinationKey(packed), slotOutputValues[i], 1u << i, offset);
     }
+    
+    processMacros();
+    emitMergedDestinations(midiMessages);
+    processRefresh(midiMessages, buffer.getNumSamples());
+    
+    // Published once per block so the editor's line is written at most once.
+    if (blockActivity != 0)
+        slotActivity.fetch_or(blockActivity, std::memory_order_relaxed);
+    
+    auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    blockTimings.push((float)(elapsed * 1.0e6), (float)(buffer.getNumSamples() * 1.0e6 / currentSampleRate));
 }
 
 bool SimpleCCProcessor::hasEditor() const
@@ -199,66 +1335,277 @@ juce::AudioProcessorEditor* SimpleCCProcessor::createEditor()
 
 void SimpleCCProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    juce::XmlElement xml("SimpleCCState");
+    SIMPLECC_TRACE_SCOPE("getStateInformation");
+
+    updateStateCache();
+    destData = cachedState;
+}
+
+void SimpleCCProcessor::updateStateCache()
+{
+    auto version = configVersion.load();
+    
+    if (cachedStateValid && cachedStateVersion == version)
+        return;
+    
+    captureState(stateScratch);
+    StateChunk::writeBinary(stateScratch, cachedState);
+    cachedStateHash = hashStateData(cachedState.getData(), cachedState.getSize());
+    cachedStateVersion = version;
+    cachedStateValid = true;
+}
+
+void SimpleCCProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+    SIMPLECC_TRACE_SCOPE("setStateInformation");
+
+    if (data == nullptr || sizeInBytes <= 0)
+        return;
+    
+    updateStateCache();
+    
+    if ((size_t)sizeInBytes == cachedState.getSize()
+        && hashStateData(data, (size_t)sizeInBytes) == cachedStateHash
+        && cachedState.matches(data, (size_t)sizeInBytes))
+        return;
+    
+    captureState(stateScratch);
+    
+    bool restored = false;
+    
+    if (StateChunk::isBinary(data, sizeInBytes))
+    {
+        restored = StateChunk::readBinary(data, sizeInBytes, stateScratch);
+    }
+    else if (auto xml = getXmlFromBinary(data, sizeInBytes))
+    {
+        restored = StateChunk::readXml(*xml, stateScratch);
+    }
+    
+    if (restored)
+        applyState(stateScratch);
+}
+
+void SimpleCCProcessor::captureState(StateChunk::State& state) const
+{
+    state.slots.resize(NUM_SLOTS);
     
     for (int i = 0; i < NUM_SLOTS; ++i)
     {
-        auto* slotXml = xml.createNewChildElement("Slot");
-        slotXml->setAttribute("index", i);
-        slotXml->setAttribute("cc", slotConfigs[i].ccNumber);
-        slotXml->setAttribute("channel", slotConfigs[i].midiChannel);
-        slotXml->setAttribute("enabled", slotConfigs[i].enabled);
-        slotXml->setAttribute("name", slotConfigs[i].name);
-        slotXml->setAttribute("value", slotParameters[i]->get());
+        auto& slot = state.slots[i];
+        slot.ccNumber = slotConfigs[i].ccNumber;
+        slot.midiChannel = slotConfigs[i].midiChannel;
+        slot.enabled = slotConfigs[i].enabled;
+        slot.messageType = slotConfigs[i].messageType;
+        slot.name = slotConfigs[i].name;
+        slot.value = slotParameters[i]->get();
+    }
+    
+    state.presetManufacturer = currentPresetManufacturer;
+    state.presetName = currentPresetName;
+    state.presetIsUser = isCurrentPresetUser;
+    state.userPreset = userPresetState;
+    
+    state.currentProgram = currentProgram;
+    state.programChangeChannel = programChangeChannel.load();
+    state.programs.clear();
+    
+    for (int p = 0; p < NUM_PROGRAMS; ++p)
+    {
+        const auto& slots = (p == currentProgram) ? slotConfigs : programs[p].slots;
+        
+        if (isDefaultProgram(p, programs[p].name, slots))
+            continue;
+        
+        StateChunk::Program program;
+        program.index = p;
+        program.name = programs[p].name;
+        program.slots.resize(NUM_SLOTS);
+        
+        for (int i = 0; i < NUM_SLOTS; ++i)
+        {
+            program.slots[i].ccNumber = slots[i].ccNumber;
+            program.slots[i].midiChannel = slots[i].midiChannel;
+            program.slots[i].enabled = slots[i].enabled;
+            program.slots[i].messageType = slots[i].messageType;
+            program.slots[i].name = slots[i].name;
+        }
+        
+        state.programs.push_back(std::move(program));
     }
     
-    if (userPresetState.isNotEmpty())
-        xml.setAttribute("userPreset", userPresetState);
+    state.morphMode = morphModeParameter->getIndex();
+    state.morphX = morphXParameter->get();
+    state.morphY = morphYParameter->get();
+    state.snapshots.resize(NUM_SNAPSHOTS);
     
-    if (currentPresetManufacturer.isNotEmpty())
-        xml.setAttribute("currentPresetManufacturer", currentPresetManufacturer);
-    if (currentPresetName.isNotEmpty())
-        xml.setAttribute("currentPresetName", currentPresetName);
-    xml.setAttribute("isCurrentPresetUser", isCurrentPresetUser);
+    for (int s = 0; s < NUM_SNAPSHOTS; ++s)
+    {
+        state.snapshots[s].resize(NUM_SLOTS);
+        
+        for (int i = 0; i < NUM_SLOTS; ++i)
+            state.snapshots[s][i] = snapshotValues[s][i].load();
+    }
+    
+    state.mergePolicy = destinationMergePolicy.load();
+    state.refreshOnTransportStart = refreshOnTransportStart.load();
+    state.keepAliveSeconds = keepAliveSeconds.load();
+    state.lookaheadMs = lookaheadMs.load();
+    state.slotSources.resize(NUM_SLOTS);
+    state.slotGridDivisions.resize(NUM_SLOTS);
+    
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        state.slotSources[i].type = slotSources[i].type;
+        state.slotSources[i].ccNumber = slotSources[i].ccNumber;
+        state.slotGridDivisions[i] = slotGridDivisions[i].load();
+    }
+    state.macros.resize(NUM_MACROS);
     
-    copyXmlToBinary(xml, destData);
+    for (int m = 0; m < NUM_MACROS; ++m)
+    {
+        auto& macro = state.macros[m];
+        macro.value = macroParameters[m]->get();
+        macro.destinations.resize(MACRO_DESTINATIONS);
+        
+        for (int d = 0; d < MACRO_DESTINATIONS; ++d)
+        {
+            const auto& source = macroDestinations[m][d];
+            auto& destination = macro.destinations[d];
+            destination.ccNumber = source.ccNumber;
+            destination.midiChannel = source.midiChannel;
+            destination.enabled = source.enabled;
+            destination.curve = source.curve;
+            destination.minValue = source.minValue;
+            destination.maxValue = source.maxValue;
+        }
+    }
 }
 
-void SimpleCCProcessor::setStateInformation(const void* data, int sizeInBytes)
+void SimpleCCProcessor::applyState(const StateChunk::State& state)
 {
-    auto xml = getXmlFromBinary(data, sizeInBytes);
+    ScopedSlotUpdate update(*this);
+    
+    int numSlots = juce::jmin(NUM_SLOTS, (int)state.slots.size());
+    
+    for (int i = 0; i < numSlots; ++i)
+    {
+        const auto& slot = state.slots[i];
+        slotConfigs[i].ccNumber = slot.ccNumber;
+        slotConfigs[i].midiChannel = slot.midiChannel;
+        slotConfigs[i].enabled = slot.enabled;
+        slotConfigs[i].messageType = juce::jlimit(0, (int)SlotMessage::numTypes - 1, slot.messageType);
+        updateSlotName(i, slot.name);
+        setSlotValue(i, slot.value);
+    }
+    
+    userPresetState = state.userPreset;
+    currentPresetManufacturer = state.presetManufacturer;
+    currentPresetName = state.presetName;
+    isCurrentPresetUser = state.presetIsUser;
+    updateSysExDump();
+    
+    for (int p = 0; p < NUM_PROGRAMS; ++p)
+        resetProgram(p);
+    
+    for (const auto& program : state.programs)
+    {
+        if (program.index < 0 || program.index >= NUM_PROGRAMS)
+            continue;
+        
+        auto& target = programs[program.index];
+        target.name = program.name;
+        
+        for (int i = 0; i < juce::jmin(NUM_SLOTS, (int)program.slots.size()); ++i)
+        {
+            target.slots[i].ccNumber = program.slots[i].ccNumber;
+            target.slots[i].midiChannel = program.slots[i].midiChannel;
+            target.slots[i].enabled = program.slots[i].enabled;
+            target.slots[i].messageType = juce::jlimit(0, (int)SlotMessage::numTypes - 1, program.slots[i].messageType);
+            target.slots[i].name = program.slots[i].name;
+        }
+    }
+    
+    int restoredProgram = juce::jlimit(0, NUM_PROGRAMS - 1, state.currentProgram);
+    programChanged = programChanged || restoredProgram != currentProgram;
+    currentProgram = restoredProgram;
+    programChangeChannel.store(juce::jlimit(-1, 16, state.programChangeChannel));
+    
+    for (int p = 0; p < NUM_PROGRAMS; ++p)
+    {
+        if (p != currentProgram)
+            compileSlotTable(p, programs[p].slots);
+    }
     
-    if (xml != nullptr && xml->hasTagName("SimpleCCState"))
+    pendingProgram.store(currentProgram);
+    
+    for (int s = 0; s < NUM_SNAPSHOTS; ++s)
+    {
+        for (int i = 0; i < NUM_SLOTS; ++i)
+        {
+            bool stored = s < (int)state.snapshots.size() && i < (int)state.snapshots[s].size();
+            snapshotValues[s][i].store(stored ? state.snapshots[s][i] : 0.0f);
+        }
+    }
+    
+    setParameterValue(*morphModeParameter, (float)juce::jlimit((int)morphOff, (int)morphXY, state.morphMode));
+    setParameterValue(*morphXParameter, state.morphX);
+    setParameterValue(*morphYParameter, state.morphY);
+    
+    for (int m = 0; m < NUM_MACROS; ++m)
     {
-        for (auto* slotXml : xml->getChildIterator())
+        const auto* macro = m < (int)state.macros.size() ? &state.macros[m] : nullptr;
+        
+        for (int d = 0; d < MACRO_DESTINATIONS; ++d)
         {
-            if (slotXml->hasTagName("Slot"))
+            MacroDestination destination;
+            
+            if (macro != nullptr && d < (int)macro->destinations.size())
             {
-                int index = slotXml->getIntAttribute("index", -1);
-                if (index >= 0 && index < NUM_SLOTS)
-                {
-                    slotConfigs[index].ccNumber = slotXml->getIntAttribute("cc", -1);
-                    slotConfigs[index].midiChannel = slotXml->getIntAttribute("channel", 1);
-                    slotConfigs[index].enabled = slotXml->getBoolAttribute("enabled", index == 0);
-                    
-                    juce::String name = slotXml->getStringAttribute("name", "Slot " + juce::String(index + 1));
-                    updateSlotName(index, name);
-                    
-                    float value = (float)slotXml->getDoubleAttribute("value", 0.0);
-                    slotParameters[index]->setValueNotifyingHost(value);
-                }
+                const auto& source = macro->destinations[d];
+                destination.ccNumber = source.ccNumber;
+                destination.midiChannel = source.midiChannel;
+                destination.enabled = source.enabled;
+                destination.curve = juce::jlimit((int)macroCurveLinear, (int)macroCurveLogarithmic, source.curve);
+                destination.minValue = source.minValue;
+                destination.maxValue = source.maxValue;
             }
+            
+            macroDestinations[m][d] = destination;
         }
         
-        userPresetState = xml->getStringAttribute("userPreset", "");
-        currentPresetManufacturer = xml->getStringAttribute("currentPresetManufacturer", "");
-        currentPresetName = xml->getStringAttribute("currentPresetName", "");
-        isCurrentPresetUser = xml->getBoolAttribute("isCurrentPresetUser", false);
+        setParameterValue(*macroParameters[m], macro != nullptr ? macro->value : 0.0f);
+    }
+    
+    destinationMergePolicy.store(juce::jlimit((int)mergeLastWins, (int)mergeWarn, state.mergePolicy));
+    refreshOnTransportStart.store(state.refreshOnTransportStart);
+    keepAliveSeconds.store(juce::jlimit(0, 3600, state.keepAliveSeconds));
+    
+    if (lookaheadMs.load() != state.lookaheadMs)
+    {
+        lookaheadMs.store(juce::jlimit(0, 100, state.lookaheadMs));
+        updateLookaheadLatency();
+    }
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        bool stored = i < (int)state.slotSources.size();
+        slotSources[i].type = stored ? juce::jlimit((int)sourceParameter, (int)sourceController, state.slotSources[i].type) : (int)sourceParameter;
+        slotSources[i].ccNumber = stored ? state.slotSources[i].ccNumber : 0;
+        
+        int division = i < (int)state.slotGridDivisions.size() ? state.slotGridDivisions[i] : (int)gridOff;
+        slotGridDivisions[i].store(juce::jlimit((int)gridOff, (int)gridBar, division));
     }
+    
+    rebuildSourceTables();
+    rebuildMacroDispatch();
+    slotConfigsChanged();
+    stateVersion.fetch_add(1, std::memory_order_release);
 }
 
 void SimpleCCProcessor::saveCurrentStateAsUserPreset(const juce::String& manufacturer, const juce::String& name)
 {
+    SIMPLECC_TRACE_SCOPE("saveCurrentStateAsUserPreset");
+
     juce::XmlElement xml("UserPreset");
     xml.setAttribute("manufacturer", manufacturer);
     xml.setAttribute("name", name);
@@ -270,16 +1617,13 @@ void SimpleCCProcessor::saveCurrentStateAsUserPreset(const juce::String& manufac
         slotXml->setAttribute("cc", slotConfigs[i].ccNumber);
         slotXml->setAttribute("channel", slotConfigs[i].midiChannel);
         slotXml->setAttribute("enabled", slotConfigs[i].enabled);
+        slotXml->setAttribute("type", slotConfigs[i].messageType);
         slotXml->setAttribute("name", slotConfigs[i].name);
         slotXml->setAttribute("value", slotParameters[i]->get());
     }
     userPresetState = xml.toString();
     
-    juce::File presetDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
-        .getChildFile("SimpleCC").getChildFile("Presets");
-    
-    if (!presetDir.exists())
-        presetDir.createDirectory();
+    juce::File presetDir = getPresetDirectory();
     
     juce::String safeFilename = (manufacturer + "_" + name).replaceCharacter(' ', '_')
         .replaceCharacter('/', '_').replaceCharacter('\\', '_')
@@ -289,17 +1633,28 @@ void SimpleCCProcessor::saveCurrentStateAsUserPreset(const juce::String& manufac
         .replaceCharacter('|', '_') + ".xml";
     
     juce::File presetFile = presetDir.getChildFile(safeFilename);
-    presetFile.replaceWithText(userPresetState);
+    
+    PresetBankPreset saved;
+    
+    if (PresetBank::parsePresetXml(xml, NUM_SLOTS, saved))
+    {
+        // A save still in flight to the same file is superseded by this one.
+        finishUserPresetSave(presetFile, false);
+        pendingUserPresetSaves.push_back({ presetFile, std::move(saved) });
+    }
+    
+    presetWriter.write(presetFile, userPresetState);
     
     currentPresetManufacturer = manufacturer;
     currentPresetName = name;
     isCurrentPresetUser = true;
+    updateSysExDump();
+    markConfigChanged();
 }
 
 void SimpleCCProcessor::loadUserPreset()
 {
-    juce::File presetDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
-        .getChildFile("SimpleCC").getChildFile("Presets");
+    juce::File presetDir = getPresetDirectory();
     
     juce::File presetFile = presetDir.getChildFile("UserPreset.xml");
     
@@ -318,6 +1673,8 @@ void SimpleCCProcessor::loadUserPreset()
     if (xml == nullptr || !xml->hasTagName("UserPreset"))
         return;
 
+    ScopedSlotUpdate update(*this);
+
     for (auto* slotXml : xml->getChildIterator())
     {
         if (slotXml->hasTagName("Slot"))
@@ -328,35 +1685,45 @@ void SimpleCCProcessor::loadUserPreset()
                 slotConfigs[index].ccNumber = slotXml->getIntAttribute("cc", -1);
                 slotConfigs[index].midiChannel = slotXml->getIntAttribute("channel", 1);
                 slotConfigs[index].enabled = slotXml->getBoolAttribute("enabled", index == 0);
+                slotConfigs[index].messageType = juce::jlimit(0, (int)SlotMessage::numTypes - 1, slotXml->getIntAttribute("type", SlotMessage::controlChange));
                 
                 juce::String name = slotXml->getStringAttribute("name", "Slot " + juce::String(index + 1));
                 updateSlotName(index, name);
                 
                 float value = (float)slotXml->getDoubleAttribute("value", 0.0);
-                slotParameters[index]->setValueNotifyingHost(value);
+                setSlotValue(index, value);
             }
         }
     }
+    
+    slotConfigsChanged();
 }
 
 void SimpleCCProcessor::resetAllSlotConfigs()
 {
+    ScopedSlotUpdate update(*this);
+    
     for (int i = 0; i < NUM_SLOTS; ++i)
     {
         slotConfigs[i].ccNumber = -1;
         slotConfigs[i].midiChannel = 1;
         slotConfigs[i].enabled = (i == 0);
+        slotConfigs[i].messageType = SlotMessage::controlChange;
         updateSlotName(i, "Slot " + juce::String(i + 1));
-        slotParameters[i]->setValueNotifyingHost(0.0f);
+        setSlotValue(i, 0.0f);
     }
     userPresetState = "";
     currentPresetManufacturer = "";
     currentPresetName = "";
     isCurrentPresetUser = false;
+    updateSysExDump();
+    slotConfigsChanged();
 }
 
 void SimpleCCProcessor::loadUserPresetFromFile(const juce::File& file)
 {
+    SIMPLECC_TRACE_SCOPE("loadUserPresetFromFile");
+
     if (!file.existsAsFile())
         return;
     
@@ -368,9 +1735,13 @@ void SimpleCCProcessor::loadUserPresetFromFile(const juce::File& file)
     if (xml == nullptr || !xml->hasTagName("UserPreset"))
         return;
     
+    ScopedSlotUpdate update(*this);
+    
     currentPresetManufacturer = xml->getStringAttribute("manufacturer", "");
     currentPresetName = xml->getStringAttribute("name", "");
     isCurrentPresetUser = true;
+    updateSysExDump();
+    slotConfigsChanged();
     
     for (auto* slotXml : xml->getChildIterator())
     {
@@ -382,12 +1753,13 @@ void SimpleCCProcessor::loadUserPresetFromFile(const juce::File& file)
                 slotConfigs[index].ccNumber = slotXml->getIntAttribute("cc", -1);
                 slotConfigs[index].midiChannel = slotXml->getIntAttribute("channel", 1);
                 slotConfigs[index].enabled = slotXml->getBoolAttribute("enabled", index == 0);
+                slotConfigs[index].messageType = juce::jlimit(0, (int)SlotMessage::numTypes - 1, slotXml->getIntAttribute("type", SlotMessage::controlChange));
                 
                 juce::String name = slotXml->getStringAttribute("name", "Slot " + juce::String(index + 1));
                 updateSlotName(index, name);
                 
                 float value = (float)slotXml->getDoubleAttribute("value", 0.0);
-                slotParameters[index]->setValueNotifyingHost(value);
+                setSlotValue(index, value);
             }
         }
     }
@@ -400,14 +1772,18 @@ void SimpleCCProcessor::loadDefaultPreset(const juce::String& manufacturer, cons
     currentPresetManufacturer = manufacturer;
     currentPresetName = name;
     isCurrentPresetUser = false;
+    updateSysExDump();
+    markConfigChanged();
 }
 
 std::vector<std::pair<juce::String, juce::String>> SimpleCCProcessor::getAllUserPresets()
 {
+    SIMPLECC_TRACE_SCOPE("getAllUserPresets");
+
     std::vector<std::pair<juce::String, juce::String>> presets;
+    userPresetLibrary.clear();
     
-    juce::File presetDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
-        .getChildFile("SimpleCC").getChildFile("Presets");
+    juce::File presetDir = getPresetDirectory();
     
     if (!presetDir.exists())
         return presets;
@@ -417,17 +1793,121 @@ std::vector<std::pair<juce::String, juce::String>> SimpleCCProcessor::getAllUser
     for (const auto& file : files)
     {
         auto xml = juce::XmlDocument::parse(file.loadFileAsString());
-        if (xml && xml->hasTagName("UserPreset"))
+        PresetBankPreset preset;
+        if (xml && PresetBank::parsePresetXml(*xml, NUM_SLOTS, preset))
         {
-            juce::String manufacturer = xml->getStringAttribute("manufacturer", "Unknown");
-            juce::String name = xml->getStringAttribute("name", "Unnamed");
-            presets.push_back({manufacturer, name});
+            presets.push_back({preset.manufacturer, preset.name});
+            userPresetLibrary.push_back(std::move(preset));
         }
     }
     
     return presets;
 }
 
+int SimpleCCProcessor::finishUserPresetSave(const juce::File& file, bool succeeded)
+{
+    auto pending = std::find_if(pendingUserPresetSaves.begin(), pendingUserPresetSaves.end(),
+                                [&file](const auto& save) { return save.first == file; });
+    
+    if (pending == pendingUserPresetSaves.end())
+        return -1;
+    
+    auto preset = std::move(pending->second);
+    pendingUserPresetSaves.erase(pending);
+    
+    if (!succeeded)
+        return -1;
+    
+    for (int i = 0; i < (int)userPresetLibrary.size(); ++i)
+    {
+        if (userPresetLibrary[i].manufacturer == preset.manufacturer && userPresetLibrary[i].name == preset.name)
+        {
+            userPresetLibrary[i] = std::move(preset);
+            return i;
+        }
+    }
+    
+    userPresetLibrary.push_back(std::move(preset));
+    return (int)userPresetLibrary.size() - 1;
+}
+
+namespace
+{
+    juce::File& getPresetDirectoryOverride()
+    {
+        static juce::File directory;
+        return directory;
+    }
+}
+
+juce::File SimpleCCProcessor::getPresetDirectory()
+{
+    if (getPresetDirectoryOverride() != juce::File())
+        return getPresetDirectoryOverride();
+    
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("SimpleCC").getChildFile("Presets");
+}
+
+void SimpleCCProcessor::setPresetDirectoryOverride(const juce::File& directory)
+{
+    getPresetDirectoryOverride() = directory;
+}
+
+void SimpleCCProcessor::refreshPresetBanks()
+{
+    SIMPLECC_TRACE_SCOPE("refreshPresetBanks");
+
+    presetBanks.clear();
+
+    juce::File presetDir = getPresetDirectory();
+
+    if (!presetDir.exists())
+        return;
+
+    juce::Array<juce::File> files = presetDir.findChildFiles(juce::File::findFiles, false,
+                                                             juce::String("*") + PresetBank::fileExtension);
+    files.sort();
+
+    for (const auto& file : files)
+    {
+        auto bank = std::make_unique<PresetBank>(file);
+        if (bank->isValid())
+            presetBanks.add(bank.release());
+    }
+}
+
+void SimpleCCProcessor::loadPresetFromBank(int bankIndex, int presetIndex)
+{
+    auto* bank = presetBanks[bankIndex];
+    if (bank == nullptr || presetIndex < 0 || presetIndex >= bank->getNumPresets())
+        return;
+
+    ScopedSlotUpdate update(*this);
+
+    currentPresetManufacturer = bank->getManufacturer(presetIndex);
+    currentPresetName = bank->getName(presetIndex);
+    isCurrentPresetUser = true;
+    updateSysExDump();
+    slotConfigsChanged();
+
+    int numSlots = juce::jmin(NUM_SLOTS, bank->getSlotsPerPreset());
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto slot = bank->getSlot(presetIndex, i);
+
+        slotConfigs[i].ccNumber = slot.ccNumber;
+        slotConfigs[i].midiChannel = slot.midiChannel;
+        slotConfigs[i].enabled = slot.enabled;
+        slotConfigs[i].messageType = juce::jlimit(0, (int)SlotMessage::numTypes - 1, slot.messageType);
+        updateSlotName(i, slot.name);
+        setSlotValue(i, slot.value);
+    }
+
+    userPresetState = "";
+}
+
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new SimpleCCProcessor();
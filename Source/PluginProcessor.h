@@ -1,8 +1,28 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <bitset>
+#include "BlockTimingRing.h"
+#include "MidiDelayLine.h"
+#include "OutputCapture.h"
+#include "SysExDump.h"
+#include "PresetBank.h"
+#include "PresetWriter.h"
+#include "SlotMessage.h"
+#include "StateChunk.h"
 
 constexpr int NUM_SLOTS = 16;
+constexpr int NUM_PROGRAMS = 128;
+constexpr int NUM_SNAPSHOTS = 4;
+constexpr int NUM_MACROS = 4;
+constexpr int MACRO_DESTINATIONS = 8;
+
+enum MorphMode
+{
+    morphOff = 0,
+    morphAB,
+    morphXY
+};
 
 struct SlotConfig
 {
@@ -10,9 +30,75 @@ struct SlotConfig
     int midiChannel = 1;
     bool enabled = false;
     juce::String name = "Slot";
+    int messageType = SlotMessage::controlChange;
+};
+
+enum MacroCurve
+{
+    macroCurveLinear = 0,
+    macroCurveExponential,
+    macroCurveLogarithmic
+};
+
+// How values that land on the same channel and CC in one block are combined.
+// Warn sends like last-wins but highlights the colliding rows in the editor.
+enum DestinationMergePolicy
+{
+    mergeLastWins = 0,
+    mergeMax,
+    mergeAverage,
+    mergeWarn
+};
+
+// What drives a slot: its own parameter, or a value taken from incoming MIDI
+// (note-on velocity, note number, channel pressure or a controller).
+enum SlotSourceType
+{
+    sourceParameter = 0,
+    sourceVelocity,
+    sourceNoteNumber,
+    sourceChannelPressure,
+    sourceController
+};
+
+struct SlotSource
+{
+    int type = sourceParameter;
+    int ccNumber = 0;
+};
+
+// Grid a slot's changes are held to; they go out on the next grid point
+// while the transport runs and immediately while it is stopped.
+enum GridDivision
+{
+    gridOff = 0,
+    grid16th,
+    grid8th,
+    gridQuarter,
+    gridHalf,
+    gridBar,
+    numGridDivisions
+};
+
+struct MacroDestination
+{
+    int ccNumber = -1;
+    int midiChannel = 1;
+    bool enabled = false;
+    int curve = macroCurveLinear;
+    int minValue = 0;
+    int maxValue = 127;
+};
+
+struct SlotProgram
+{
+    juce::String name;
+    std::array<SlotConfig, NUM_SLOTS> slots;
 };
 
-class SimpleCCProcessor : public juce::AudioProcessor
+class SimpleCCProcessor : public juce::AudioProcessor,
+                          private juce::AudioProcessorParameter::Listener,
+                          private juce::Timer
 {
 public:
     SimpleCCProcessor();
@@ -44,35 +130,365 @@ public:
     void getStateInformation(juce::MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
 
-    SlotConfig& getSlotConfig(int slot) { return slotConfigs[slot]; }
+    const SlotConfig& getSlotConfig(int slot) const { return slotConfigs[slot]; }
+    void setSlotEnabled(int slot, bool enabled);
+    void setSlotMessageType(int slot, int messageType);
+    void setSlotCCNumber(int slot, int ccNumber);
+    void setSlotMidiChannel(int slot, int midiChannel);
     juce::AudioParameterFloat* getSlotParameter(int slot) { return slotParameters[slot]; }
     void updateSlotName(int slot, const juce::String& newName);
+    void setSlotValue(int slot, float value);
+
+    class ScopedSlotUpdate
+    {
+    public:
+        explicit ScopedSlotUpdate(SimpleCCProcessor& p) : processor(p) { processor.beginSlotUpdate(); }
+        ~ScopedSlotUpdate() { processor.endSlotUpdate(); }
+
+    private:
+        SimpleCCProcessor& processor;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedSlotUpdate)
+    };
+
+    void beginSlotUpdate();
+    void endSlotUpdate();
+
+    // Advances whenever anything a slot row shows changes, by whatever path,
+    // so an editor can poll it and refresh only the rows that did.
+    juce::uint32 getSlotVersion(int slot) const { return slotVersions[slot].load(std::memory_order_acquire); }
 
-    bool getSlotActivity(int slot) const { return slotActivity[slot].load(); }
-    void clearSlotActivity(int slot) { slotActivity[slot].store(false); }
+    // Advances each time setStateInformation restores a state.
+    juce::uint32 getStateVersion() const { return stateVersion.load(std::memory_order_acquire); }
+
+    bool getSlotActivity(int slot) const { return ((slotActivity.load(std::memory_order_relaxed) >> slot) & 1) != 0; }
+    void clearSlotActivity(int slot) { slotActivity.fetch_and(~(1u << slot), std::memory_order_relaxed); }
 
     void saveCurrentStateAsUserPreset(const juce::String& manufacturer, const juce::String& name);
     void loadUserPreset();
     void loadUserPresetFromFile(const juce::File& file);
     void loadDefaultPreset(const juce::String& manufacturer, const juce::String& name);
     std::vector<std::pair<juce::String, juce::String>> getAllUserPresets();
+    const std::vector<PresetBankPreset>& getUserPresetLibrary() const { return userPresetLibrary; }
+    // Called when the writer reports on a file from saveCurrentStateAsUserPreset.
+    // A successful save enters the library in place of any preset with the
+    // same name, without rescanning the directory. Returns its library index,
+    // or -1 if the save failed or the file wasn't a user preset save.
+    int finishUserPresetSave(const juce::File& file, bool succeeded);
     void resetAllSlotConfigs();
     const juce::String& getUserPresetState() const { return userPresetState; }
+
+    static juce::File getPresetDirectory();
+    // Points every instance at another preset directory, for benchmarks and
+    // tools that must not touch the user's library. An empty File restores
+    // the default.
+    static void setPresetDirectoryOverride(const juce::File& directory);
+    void refreshPresetBanks();
+    int getNumPresetBanks() const { return presetBanks.size(); }
+    const PresetBank* getPresetBank(int bankIndex) const { return presetBanks[bankIndex]; }
+    void loadPresetFromBank(int bankIndex, int presetIndex);
+    PresetWriter& getPresetWriter() { return presetWriter; }
     
     juce::String getCurrentPresetManufacturer() const { return currentPresetManufacturer; }
     juce::String getCurrentPresetName() const { return currentPresetName; }
     bool isUserPreset() const { return isCurrentPresetUser; }
 
+    juce::uint32 getConfigVersion() const { return configVersion.load(); }
+
+    // Program change receive channel: -1 off, 0 omni, 1-16 a single channel.
+    int getProgramChangeChannel() const { return programChangeChannel.load(); }
+    void setProgramChangeChannel(int channel);
+
+    // Snapshots A-D hold a value for every slot. While morphing is on, the
+    // slots send a blend of them instead of their own parameter values: A to B
+    // along X, or bilinear across A (0,0), B (1,0), C (0,1) and D (1,1).
+    void captureSnapshot(int snapshot);
+    float getSnapshotValue(int snapshot, int slot) const { return snapshotValues[snapshot][slot].load(); }
+    juce::AudioParameterChoice* getMorphModeParameter() { return morphModeParameter; }
+    juce::AudioParameterFloat* getMorphXParameter() { return morphXParameter; }
+    juce::AudioParameterFloat* getMorphYParameter() { return morphYParameter; }
+
+    // Each macro parameter drives up to MACRO_DESTINATIONS controllers, each
+    // scaled into its own min/max range through its own curve.
+    juce::AudioParameterFloat* getMacroParameter(int macro) { return macroParameters[macro]; }
+    const MacroDestination& getMacroDestination(int macro, int destination) const { return macroDestinations[macro][destination]; }
+    void setMacroDestination(int macro, int destination, const MacroDestination& newDestination);
+
+    int getDestinationMergePolicy() const { return destinationMergePolicy.load(); }
+    void setDestinationMergePolicy(int policy);
+    bool hasSlotCollision(int slot) const { return slotCollisions.test((size_t)slot); }
+    bool hasMacroCollision(int macro, int destination) const { return macroCollisions.test((size_t)(macro * MACRO_DESTINATIONS + destination)); }
+
+    // A refresh resends the last value of every active destination, paced at
+    // refreshBytesPerSecond across successive blocks so it never lands as a
+    // single burst ahead of notes.
+    void requestRefresh() { refreshRequested.store(true); }
+    bool getRefreshOnTransportStart() const { return refreshOnTransportStart.load(); }
+    void setRefreshOnTransportStart(bool shouldRefresh);
+    int getKeepAliveSeconds() const { return keepAliveSeconds.load(); }
+    void setKeepAliveSeconds(int seconds);
+
+    // With lookahead on, incoming MIDI is delayed by the lookahead time and
+    // reported to the host as latency, while generated CCs go out undelayed,
+    // so they reach the synth that much ahead of the notes they precede.
+    int getLookaheadMs() const { return lookaheadMs.load(); }
+    void setLookaheadMs(int ms);
+
+    const SlotSource& getSlotSource(int slot) const { return slotSources[slot]; }
+    void setSlotSource(int slot, const SlotSource& source);
+
+    int getSlotGridDivision(int slot) const { return slotGridDivisions[slot].load(); }
+    void setSlotGridDivision(int slot, int division);
+
+    // How long each processBlock call took, next to the block's duration.
+    const BlockTimingRing& getBlockTimings() const { return blockTimings; }
+
+    // Everything processBlock generated recently, by slot.
+    OutputCapture& getOutputCapture() { return outputCapture; }
+
 private:
+    void captureState(StateChunk::State& state) const;
+    void applyState(const StateChunk::State& state);
+    void updateStateCache();
+    void flushHostNotifications();
+    void setParameterValue(juce::RangedAudioParameter& parameter, float value);
+    void publishSlotVersions();
+    void markConfigChanged() { ++configVersion; }
+    void slotConfigsChanged();
+    void switchToProgram(int index);
+    void compileSlotTable(int program, const std::array<SlotConfig, NUM_SLOTS>& slots);
+    void resetProgram(int program);
+    void timerCallback() override;
+    void computeMorphedValues(int mode);
+    void rebuildMacroDispatch();
+    void processMacros();
+    void rebuildDestinationIndex();
+    void addDestinationValue(int key, float value, juce::uint32 slotMask, int samplePosition = 0);
+    void addHeldDestination(int key, juce::uint32 slotMask);
+    void sendDestination(juce::MidiBuffer& midiMessages, int key, int value, int samplePosition, int slot);
+    bool sendDestinationValue(juce::MidiBuffer& midiMessages, int key, float normalizedValue, int samplePosition, int slot);
+    void resetSentValues();
+    void updateSysExDump();
+    juce::uint32 sendSysExDump(juce::MidiBuffer& midiMessages, int samplePosition, int& numBytes);
+    static int getSlotDestinationKey(juce::uint32 packed);
+    static int getMacroDestinationKey(juce::uint32 packed);
+    void emitMergedDestinations(juce::MidiBuffer& midiMessages);
+    void processRefresh(juce::MidiBuffer& midiMessages, int numSamples);
+    void readTransport(int numSamples);
+    void updateLookaheadLatency();
+    void delayIncomingMidi(juce::MidiBuffer& midiMessages, int numSamples);
+    void rebuildSourceTables();
+    void scanIncomingMidi(const juce::MidiBuffer& midiMessages);
+    void emitModulationEvents(juce::MidiBuffer& midiMessages);
+
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override;
+
+    // Members are grouped by the thread that writes them: message-thread
+    // state first, then what the two threads hand each other, then the audio
+    // thread's own state. The last two groups each start on a fresh cache
+    // line, so editing names, presets or configs never evicts a line that
+    // processBlock is using.
+
+    // Message thread.
     std::array<SlotConfig, NUM_SLOTS> slotConfigs;
-    std::array<juce::AudioParameterFloat*, NUM_SLOTS> slotParameters;
-    std::array<int, NUM_SLOTS> lastSentValues;
-    std::array<std::atomic<bool>, NUM_SLOTS> slotActivity;
     juce::String userPresetState;
+    juce::OwnedArray<PresetBank> presetBanks;
+    std::vector<PresetBankPreset> userPresetLibrary;
+    std::vector<std::pair<juce::File, PresetBankPreset>> pendingUserPresetSaves;
     
     juce::String currentPresetManufacturer;
     juce::String currentPresetName;
     bool isCurrentPresetUser = false;
+    StateChunk::State stateScratch;
+
+    juce::MemoryBlock cachedState;
+    juce::uint32 cachedStateVersion = 0;
+    juce::uint64 cachedStateHash = 0;
+    bool cachedStateValid = false;
+
+    int slotUpdateDepth = 0;
+    bool parameterInfoChanged = false;
+    std::array<float, NUM_SLOTS> pendingSlotValues {};
+    std::bitset<NUM_SLOTS> pendingSlotValueMask;
+    // Morph and macro values held back the same way, as plain values.
+    static constexpr int maxPendingParameterValues = NUM_MACROS + 3;
+    std::array<std::pair<juce::RangedAudioParameter*, float>, maxPendingParameterValues> pendingParameterValues {};
+    int numPendingParameterValues = 0;
+
+    std::array<SlotProgram, NUM_PROGRAMS> programs;
+    int currentProgram = 0;
+    bool slotTableDirty = false;
+    bool programChanged = false;
+
+    std::array<std::array<MacroDestination, MACRO_DESTINATIONS>, NUM_MACROS> macroDestinations;
+    std::array<SlotSource, NUM_SLOTS> slotSources;
+    std::bitset<NUM_SLOTS> slotCollisions;
+    std::bitset<NUM_MACROS * MACRO_DESTINATIONS> macroCollisions;
+
+    // What each slot looked like when its version last advanced.
+    struct PublishedSlot
+    {
+        SlotConfig config;
+        SlotSource source;
+        int gridDivision = gridOff;
+    };
+
+    std::array<PublishedSlot, NUM_SLOTS> publishedSlots;
+
+    // Shared between the message and audio threads.
+    // Slots that sent since the editor last looked, one bit per slot. The
+    // audio thread ORs in a block's worth at once; it has the line to itself
+    // because both threads write it.
+    alignas(64) std::atomic<juce::uint32> slotActivity { 0 };
+
+    // The rest is written rarely by one side and read by the other.
+    alignas(64) std::atomic<juce::uint32> configVersion { 0 };
+
+    // Each program's slots packed for the audio thread: cc or note in bits
+    // 0-6, channel - 1 in bits 8-11, bit 16 set when the slot sends and the
+    // message type in bits 20-22; 0 means skip. One table is one cache line.
+    struct alignas(64) CompiledSlotTable
+    {
+        std::array<std::atomic<juce::uint32>, NUM_SLOTS> entries;
+    };
+
+    std::array<CompiledSlotTable, NUM_PROGRAMS> compiledTables;
+    std::atomic<int> pendingProgram { -1 };
+    std::atomic<int> programChangeFromMidi { -1 };
+    std::atomic<int> programChangeChannel { -1 };
+
+    std::array<std::array<std::atomic<float>, NUM_SLOTS>, NUM_SNAPSHOTS> snapshotValues;
+
+    // Every active macro destination, flattened and packed for the audio
+    // thread: cc in bits 0-6, channel - 1 in bits 8-11, curve in bits 12-13,
+    // macro in bits 14-15, min in bits 16-22 and max in bits 24-30.
+    static constexpr int maxMacroDispatch = NUM_MACROS * MACRO_DESTINATIONS;
+    std::array<std::atomic<juce::uint32>, maxMacroDispatch> macroDispatch;
+    std::atomic<int> numMacroDispatch { 0 };
+    std::atomic<juce::uint32> macroDispatchVersion { 0 };
+
+    // Destination keys a dispatch change added or altered, which the audio
+    // thread forgets the last sent value of when it picks up the new version.
+    // Keys queued since the last version it acknowledged accumulate; more than
+    // maxMacroKeyResets of them and it forgets every key instead.
+    static constexpr int maxMacroKeyResets = maxMacroDispatch;
+    std::array<std::atomic<juce::uint16>, maxMacroKeyResets> macroKeyResets;
+    std::atomic<int> numMacroKeyResets { 0 };
+    std::atomic<juce::uint32> macroDispatchVersionSeen { 0 };
+
+    std::atomic<int> destinationMergePolicy { mergeLastWins };
+
+    BlockTimingRing blockTimings;
+    OutputCapture outputCapture;
+
+    static constexpr double refreshBytesPerSecond = 1000.0;
+    std::atomic<bool> refreshRequested { false };
+    std::atomic<bool> refreshOnTransportStart { false };
+    std::atomic<int> keepAliveSeconds { 0 };
+
+    // The current instrument preset's SysEx template, rendered on the message
+    // thread. It replaces per-slot messages on recall and refresh.
+    SysExDump sysexDump;
+    juce::SpinLock sysexLock;
+    std::atomic<bool> sysexRecallPending { false };
+
+    std::atomic<int> lookaheadMs { 0 };
+    std::atomic<int> lookaheadSamples { 0 };
+
+    // Slots driven by incoming MIDI, found with one lookup per event: by
+    // status byte for note-on (velocity slots in the low 16 bits, note number
+    // slots in the high 16) and channel pressure, by controller number for CC.
+    std::array<std::atomic<juce::uint32>, 128> statusSourceTable;
+    std::array<std::atomic<juce::uint32>, 128> controllerSourceTable;
+    std::atomic<juce::uint32> midiSourcedSlots { 0 };
+
+    std::array<std::atomic<int>, NUM_SLOTS> slotGridDivisions;
+
+    std::array<std::atomic<juce::uint32>, NUM_SLOTS> slotVersions {};
+    std::atomic<juce::uint32> stateVersion { 0 };
+
+    // Audio thread. The per-block scalars come first and share two lines.
+    alignas(64) const CompiledSlotTable* activeSlotTable = nullptr;
+    juce::int64 blockStartTime = 0;
+    juce::int64 sampleClock = 0;
+    juce::int64 samplesSinceRefresh = 0;
+    double currentSampleRate = 44100.0;
+    double refreshCountdown = 0.0;
+    juce::uint32 mergeStamp = 0;
+    juce::uint32 blockActivity = 0;
+    juce::uint32 refreshSysExSlots = 0;
+    juce::uint32 lastMacroDispatchVersion = 0;
+    int numMergedDestinations = 0;
+    int numModulationEvents = 0;
+    int refreshIndex = 0;
+    bool isPlaying = false;
+    bool wasPlaying = false;
+    bool refreshActive = false;
+
+    // Set in the constructor and only read afterwards.
+    std::array<juce::AudioParameterFloat*, NUM_SLOTS> slotParameters;
+    std::array<juce::AudioParameterFloat*, NUM_MACROS> macroParameters {};
+    juce::AudioParameterChoice* morphModeParameter = nullptr;
+    juce::AudioParameterFloat* morphXParameter = nullptr;
+    juce::AudioParameterFloat* morphYParameter = nullptr;
+
+    alignas(16) std::array<float, NUM_SLOTS> slotOutputValues {};
+    alignas(16) std::array<std::array<float, NUM_SLOTS>, NUM_SNAPSHOTS> snapshotScratch {};
+
+    // Sample offset of the next grid point inside the current block for each
+    // division, or -1 when none falls in it. Filled from the play head once
+    // per block, so a tempo change takes effect on the block it arrives in.
+    std::array<int, numGridDivisions> gridReleaseOffsets {};
+
+    // Per block, every slot and macro value is collected by destination key
+    // and at most one message per destination is sent. A key's stamp marks it
+    // as touched this block so nothing has to be cleared between blocks.
+    // Grid slots join at their release offset; one holding its value until a
+    // later block still joins, with no value (count 0), so that refresh
+    // covers its destination.
+    static constexpr int numDestinationKeys = SlotMessage::numDestinationKeys;
+
+    struct MergedDestination
+    {
+        int key;
+        float sum;
+        float maximum;
+        float last;
+        int count;
+        juce::uint32 slotMask;
+        int samplePosition;
+        bool sent;
+    };
+
+    // Everything kept per destination key, together so that a send touches
+    // one cache line rather than one in each of three arrays. -1 is unsent.
+    struct DestinationKeyState
+    {
+        int lastSentValue = -1;
+        int entry = 0;
+        juce::uint32 stamp = 0;
+    };
+
+    std::array<MergedDestination, NUM_SLOTS + maxMacroDispatch> mergedDestinations;
+    std::array<DestinationKeyState, numDestinationKeys> destinationKeys;
+
+    struct ModulationEvent
+    {
+        int samplePosition;
+        int slot;
+        int value;
+    };
+
+    static constexpr int maxModulationEvents = 256;
+    std::array<ModulationEvent, maxModulationEvents> modulationEvents;
+
+    static constexpr size_t midiDelayCapacity = 64 * 1024;
+    MidiDelayLine midiDelay;
+    int appliedLookaheadSamples = 0;
+    juce::MidiBuffer incomingScratch;
+
+    PresetWriter presetWriter;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SimpleCCProcessor)
 };
@@ -0,0 +1,354 @@
+#include "PresetBank.h"
+
+namespace
+{
+    constexpr char bankMagic[4] = { 'S', 'C', 'C', 'B' };
+    constexpr juce::uint8 slotEnabledFlag = 0x01;
+
+    juce::uint32 readUInt32(const juce::uint8* p)
+    {
+        return juce::ByteOrder::littleEndianInt(p);
+    }
+
+    float readFloat(const juce::uint8* p)
+    {
+        auto bits = readUInt32(p);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+PresetBank::PresetBank(const juce::File& bankFile)
+    : file(bankFile)
+{
+    mappedFile = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+
+    auto* base = static_cast<const juce::uint8*>(mappedFile->getData());
+    auto size = mappedFile->getSize();
+
+    if (base == nullptr || size < (size_t)headerSize || std::memcmp(base, bankMagic, sizeof(bankMagic)) != 0)
+        return;
+
+    if (juce::ByteOrder::littleEndianShort(base + 4) != formatVersion)
+        return;
+
+    auto slots = (juce::uint32)juce::ByteOrder::littleEndianShort(base + 6);
+    auto presets = readUInt32(base + 8);
+    auto index = readUInt32(base + 12);
+    auto slotData = readUInt32(base + 16);
+    auto strings = readUInt32(base + 20);
+    auto stringBytes = readUInt32(base + 24);
+
+    auto fits = [size](juce::uint64 offset, juce::uint64 length) {
+        return offset + length <= (juce::uint64)size;
+    };
+
+    if (slots == 0 || presets > (juce::uint32)std::numeric_limits<int>::max()
+        || !fits(index, (juce::uint64)presets * indexEntrySize)
+        || !fits(slotData, (juce::uint64)presets * slots * slotRecordSize)
+        || stringBytes == 0 || !fits(strings, stringBytes)
+        || base[strings + stringBytes - 1] != 0)
+        return;
+
+    data = base;
+    dataSize = size;
+    numPresets = (int)presets;
+    slotsPerPreset = (int)slots;
+    indexOffset = index;
+    slotsOffset = slotData;
+    stringsOffset = strings;
+    stringsSize = stringBytes;
+}
+
+const char* PresetBank::stringAt(juce::uint32 offset) const
+{
+    if (offset >= stringsSize)
+        return "";
+
+    return reinterpret_cast<const char*>(data + stringsOffset + offset);
+}
+
+const juce::uint8* PresetBank::slotRecord(int presetIndex, int slotIndex) const
+{
+    auto* entry = data + indexOffset + (size_t)presetIndex * indexEntrySize;
+    auto firstSlot = (juce::uint64)readUInt32(entry + 8);
+
+    if (firstSlot + (juce::uint64)slotsPerPreset > (juce::uint64)numPresets * (juce::uint64)slotsPerPreset)
+        return nullptr;
+
+    return data + slotsOffset + (size_t)(firstSlot + (juce::uint64)slotIndex) * slotRecordSize;
+}
+
+const char* PresetBank::getManufacturerUTF8(int presetIndex) const
+{
+    if (!isValid() || presetIndex < 0 || presetIndex >= numPresets)
+        return "";
+
+    return stringAt(readUInt32(data + indexOffset + (size_t)presetIndex * indexEntrySize));
+}
+
+const char* PresetBank::getNameUTF8(int presetIndex) const
+{
+    if (!isValid() || presetIndex < 0 || presetIndex >= numPresets)
+        return "";
+
+    return stringAt(readUInt32(data + indexOffset + (size_t)presetIndex * indexEntrySize + 4));
+}
+
+juce::String PresetBank::getManufacturer(int presetIndex) const
+{
+    return juce::String::fromUTF8(getManufacturerUTF8(presetIndex));
+}
+
+juce::String PresetBank::getName(int presetIndex) const
+{
+    return juce::String::fromUTF8(getNameUTF8(presetIndex));
+}
+
+const char* PresetBank::getSlotNameUTF8(int presetIndex, int slotIndex) const
+{
+    if (!isValid() || presetIndex < 0 || presetIndex >= numPresets || slotIndex < 0 || slotIndex >= slotsPerPreset)
+        return "";
+
+    if (auto* record = slotRecord(presetIndex, slotIndex))
+        return stringAt(readUInt32(record + 8));
+
+    return "";
+}
+
+PresetBankSlot PresetBank::getSlot(int presetIndex, int slotIndex) const
+{
+    PresetBankSlot slot;
+
+    if (!isValid() || presetIndex < 0 || presetIndex >= numPresets || slotIndex < 0 || slotIndex >= slotsPerPreset)
+        return slot;
+
+    if (auto* record = slotRecord(presetIndex, slotIndex))
+    {
+        slot.ccNumber = (int)(juce::int8)record[0];
+        slot.midiChannel = juce::jlimit(1, 16, (int)record[1]);
+        slot.enabled = (record[2] & slotEnabledFlag) != 0;
+        slot.messageType = record[3];
+        slot.value = juce::jlimit(0.0f, 1.0f, readFloat(record + 4));
+        slot.name = juce::String::fromUTF8(stringAt(readUInt32(record + 8)));
+    }
+
+    return slot;
+}
+
+int PresetBank::findPreset(const juce::String& manufacturer, const juce::String& name) const
+{
+    auto manufacturerUTF8 = manufacturer.toRawUTF8();
+    auto nameUTF8 = name.toRawUTF8();
+
+    for (int i = 0; i < numPresets; ++i)
+    {
+        if (std::strcmp(getNameUTF8(i), nameUTF8) == 0 && std::strcmp(getManufacturerUTF8(i), manufacturerUTF8) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+PresetBankPreset PresetBank::getPreset(int presetIndex) const
+{
+    PresetBankPreset preset;
+    preset.manufacturer = getManufacturer(presetIndex);
+    preset.name = getName(presetIndex);
+
+    for (int i = 0; i < slotsPerPreset; ++i)
+        preset.slots.push_back(getSlot(presetIndex, i));
+
+    return preset;
+}
+
+std::unique_ptr<juce::XmlElement> PresetBank::createPresetXml(int presetIndex) const
+{
+    return createPresetXml(getPreset(presetIndex));
+}
+
+std::unique_ptr<juce::XmlElement> PresetBank::createPresetXml(const PresetBankPreset& preset)
+{
+    auto xml = std::make_unique<juce::XmlElement>("UserPreset");
+    xml->setAttribute("manufacturer", preset.manufacturer);
+    xml->setAttribute("name", preset.name);
+
+    for (int i = 0; i < (int)preset.slots.size(); ++i)
+    {
+        const auto& slot = preset.slots[(size_t)i];
+        auto* slotXml = xml->createNewChildElement("Slot");
+        slotXml->setAttribute("index", i);
+        slotXml->setAttribute("cc", slot.ccNumber);
+        slotXml->setAttribute("channel", slot.midiChannel);
+        slotXml->setAttribute("enabled", slot.enabled);
+        slotXml->setAttribute("type", slot.messageType);
+        slotXml->setAttribute("name", slot.name);
+        slotXml->setAttribute("value", slot.value);
+    }
+
+    return xml;
+}
+
+bool PresetBank::parsePresetXml(const juce::XmlElement& xml, int numSlots, PresetBankPreset& result)
+{
+    if (!xml.hasTagName("UserPreset"))
+        return false;
+
+    result.manufacturer = xml.getStringAttribute("manufacturer", "Unknown");
+    result.name = xml.getStringAttribute("name", "Unnamed");
+    result.slots.assign((size_t)numSlots, {});
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        result.slots[(size_t)i].enabled = (i == 0);
+        result.slots[(size_t)i].name = "Slot " + juce::String(i + 1);
+    }
+
+    for (auto* slotXml : xml.getChildIterator())
+    {
+        if (slotXml->hasTagName("Slot"))
+        {
+            int index = slotXml->getIntAttribute("index", -1);
+            if (index >= 0 && index < numSlots)
+            {
+                auto& slot = result.slots[(size_t)index];
+                slot.ccNumber = slotXml->getIntAttribute("cc", -1);
+                slot.midiChannel = slotXml->getIntAttribute("channel", 1);
+                slot.enabled = slotXml->getBoolAttribute("enabled", index == 0);
+                slot.messageType = juce::jlimit(0, 255, slotXml->getIntAttribute("type", 0));
+                slot.name = slotXml->getStringAttribute("name", "Slot " + juce::String(index + 1));
+                slot.value = (float)slotXml->getDoubleAttribute("value", 0.0);
+            }
+        }
+    }
+
+    return true;
+}
+
+PresetBankBuilder::PresetBankBuilder(int numSlotsPerPreset)
+    : slotsPerPreset(juce::jlimit(1, 0xffff, numSlotsPerPreset))
+{
+    addString({});
+}
+
+juce::uint32 PresetBankBuilder::addString(const juce::String& text)
+{
+    auto existing = stringOffsets.find(text);
+    if (existing != stringOffsets.end())
+        return existing->second;
+
+    auto offset = (juce::uint32)strings.getDataSize();
+    strings.write(text.toRawUTF8(), text.getNumBytesAsUTF8());
+    strings.writeByte(0);
+    stringOffsets[text] = offset;
+    return offset;
+}
+
+void PresetBankBuilder::addPreset(const PresetBankPreset& preset)
+{
+    presets.push_back({ addString(preset.manufacturer), addString(preset.name) });
+
+    for (int i = 0; i < slotsPerPreset; ++i)
+    {
+        PresetBankSlot source;
+        if (i < (int)preset.slots.size())
+            source = preset.slots[(size_t)i];
+        else
+            source.name = "Slot " + juce::String(i + 1);
+
+        Slot slot;
+        slot.ccNumber = (juce::int8)juce::jlimit(-1, 127, source.ccNumber);
+        slot.midiChannel = (juce::uint8)juce::jlimit(1, 16, source.midiChannel);
+        slot.flags = source.enabled ? slotEnabledFlag : 0;
+        slot.messageType = (juce::uint8)juce::jlimit(0, 255, source.messageType);
+        slot.value = juce::jlimit(0.0f, 1.0f, source.value);
+        slot.nameOffset = addString(source.name);
+        slots.push_back(slot);
+    }
+}
+
+bool PresetBankBuilder::addPresetXml(const juce::XmlElement& xml)
+{
+    PresetBankPreset preset;
+    if (!PresetBank::parsePresetXml(xml, slotsPerPreset, preset))
+        return false;
+
+    addPreset(preset);
+    return true;
+}
+
+int PresetBankBuilder::addPresetXmlDirectory(const juce::File& directory)
+{
+    auto files = directory.findChildFiles(juce::File::findFiles, false, "*.xml");
+    files.sort();
+
+    int numAdded = 0;
+    for (const auto& presetFile : files)
+    {
+        if (auto xml = juce::XmlDocument::parse(presetFile))
+        {
+            if (addPresetXml(*xml))
+                ++numAdded;
+        }
+    }
+
+    return numAdded;
+}
+
+void PresetBankBuilder::writeTo(juce::OutputStream& out) const
+{
+    auto numPresets = (juce::uint32)presets.size();
+    auto indexOffset = (juce::uint32)PresetBank::headerSize;
+    auto slotsOffset = indexOffset + numPresets * (juce::uint32)PresetBank::indexEntrySize;
+    auto stringsOffset = slotsOffset + (juce::uint32)slots.size() * (juce::uint32)PresetBank::slotRecordSize;
+
+    out.write(bankMagic, sizeof(bankMagic));
+    out.writeShort((short)PresetBank::formatVersion);
+    out.writeShort((short)slotsPerPreset);
+    out.writeInt((int)numPresets);
+    out.writeInt((int)indexOffset);
+    out.writeInt((int)slotsOffset);
+    out.writeInt((int)stringsOffset);
+    out.writeInt((int)strings.getDataSize());
+    out.writeInt(0);
+
+    for (size_t i = 0; i < presets.size(); ++i)
+    {
+        out.writeInt((int)presets[i].manufacturerOffset);
+        out.writeInt((int)presets[i].nameOffset);
+        out.writeInt((int)(i * (size_t)slotsPerPreset));
+        out.writeInt(0);
+    }
+
+    for (const auto& slot : slots)
+    {
+        out.writeByte((char)slot.ccNumber);
+        out.writeByte((char)slot.midiChannel);
+        out.writeByte((char)slot.flags);
+        out.writeByte((char)slot.messageType);
+        out.writeFloat(slot.value);
+        out.writeInt((int)slot.nameOffset);
+    }
+
+    out.write(strings.getData(), strings.getDataSize());
+}
+
+bool PresetBankBuilder::writeToFile(const juce::File& bankFile) const
+{
+    juce::TemporaryFile temp(bankFile);
+
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk())
+            return false;
+
+        writeTo(out);
+        out.flush();
+
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
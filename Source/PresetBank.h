@@ -0,0 +1,131 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+#include <vector>
+
+// Single-file preset bank.
+//
+// Layout (all integers little-endian):
+//   Header       magic "SCCB", version, slotsPerPreset, numPresets and the
+//                offsets/sizes of the three sections below
+//   Index        one 16 byte entry per preset: manufacturer and name string
+//                offsets plus the index of the preset's first slot record
+//   Slot records slotsPerPreset fixed-size records per preset: cc, channel,
+//                flags, message type, value and name offset
+//   Strings      NUL-terminated UTF-8, shared between presets
+//
+// The bank is memory-mapped read-only and every lookup is an offset calculation
+// into the mapped file, so opening a bank with tens of thousands of presets
+// costs the same as opening one with a single preset.
+
+struct PresetBankSlot
+{
+    int ccNumber = -1;
+    int midiChannel = 1;
+    bool enabled = false;
+    int messageType = 0;
+    float value = 0.0f;
+    juce::String name;
+};
+
+struct PresetBankPreset
+{
+    juce::String manufacturer;
+    juce::String name;
+    std::vector<PresetBankSlot> slots;
+};
+
+class PresetBank
+{
+public:
+    static constexpr const char* fileExtension = ".sccbank";
+    static constexpr juce::uint16 formatVersion = 1;
+    static constexpr int headerSize = 32;
+    static constexpr int indexEntrySize = 16;
+    static constexpr int slotRecordSize = 12;
+
+    explicit PresetBank(const juce::File& bankFile);
+
+    bool isValid() const { return data != nullptr; }
+    const juce::File& getFile() const { return file; }
+
+    int getNumPresets() const { return numPresets; }
+    int getSlotsPerPreset() const { return slotsPerPreset; }
+
+    const char* getManufacturerUTF8(int presetIndex) const;
+    const char* getNameUTF8(int presetIndex) const;
+    juce::String getManufacturer(int presetIndex) const;
+    juce::String getName(int presetIndex) const;
+
+    PresetBankSlot getSlot(int presetIndex, int slotIndex) const;
+    const char* getSlotNameUTF8(int presetIndex, int slotIndex) const;
+
+    int findPreset(const juce::String& manufacturer, const juce::String& name) const;
+
+    PresetBankPreset getPreset(int presetIndex) const;
+    std::unique_ptr<juce::XmlElement> createPresetXml(int presetIndex) const;
+
+    static std::unique_ptr<juce::XmlElement> createPresetXml(const PresetBankPreset& preset);
+    static bool parsePresetXml(const juce::XmlElement& xml, int numSlots, PresetBankPreset& result);
+
+private:
+    const juce::uint8* slotRecord(int presetIndex, int slotIndex) const;
+    const char* stringAt(juce::uint32 offset) const;
+
+    juce::File file;
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    const juce::uint8* data = nullptr;
+    size_t dataSize = 0;
+
+    int numPresets = 0;
+    int slotsPerPreset = 0;
+    juce::uint32 indexOffset = 0;
+    juce::uint32 slotsOffset = 0;
+    juce::uint32 stringsOffset = 0;
+    juce::uint32 stringsSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetBank)
+};
+
+class PresetBankBuilder
+{
+public:
+    explicit PresetBankBuilder(int slotsPerPreset);
+
+    void addPreset(const PresetBankPreset& preset);
+    bool addPresetXml(const juce::XmlElement& xml);
+    int addPresetXmlDirectory(const juce::File& directory);
+
+    int getNumPresets() const { return (int)presets.size(); }
+
+    void writeTo(juce::OutputStream& out) const;
+    bool writeToFile(const juce::File& bankFile) const;
+
+private:
+    juce::uint32 addString(const juce::String& text);
+
+    struct Entry
+    {
+        juce::uint32 manufacturerOffset;
+        juce::uint32 nameOffset;
+    };
+
+    struct Slot
+    {
+        juce::int8 ccNumber;
+        juce::uint8 midiChannel;
+        juce::uint8 flags;
+        juce::uint8 messageType;
+        float value;
+        juce::uint32 nameOffset;
+    };
+
+    int slotsPerPreset;
+    std::vector<Entry> presets;
+    std::vector<Slot> slots;
+    juce::MemoryOutputStream strings;
+    std::map<juce::String, juce::uint32> stringOffsets;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetBankBuilder)
+};
@@ -0,0 +1,249 @@
+#include "PresetSearchIndex.h"
+
+namespace
+{
+    constexpr char fieldSeparator = '\n';
+
+    char foldCase(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+    }
+
+    bool isSeparator(char c)
+    {
+        return c == ' ' || c == fieldSeparator || c == '\t';
+    }
+
+    juce::uint32 trigramKey(const char* p)
+    {
+        return ((juce::uint32)(juce::uint8)p[0] << 16) | ((juce::uint32)(juce::uint8)p[1] << 8) | (juce::uint32)(juce::uint8)p[2];
+    }
+
+    std::vector<std::string> tokenise(const juce::String& query)
+    {
+        std::vector<std::string> tokens;
+        std::string current;
+
+        for (auto* p = query.toRawUTF8(); *p != 0; ++p)
+        {
+            if (isSeparator(*p))
+            {
+                if (!current.empty())
+                    tokens.push_back(std::move(current));
+                current.clear();
+            }
+            else
+            {
+                current.push_back(foldCase(*p));
+            }
+        }
+
+        if (!current.empty())
+            tokens.push_back(std::move(current));
+
+        std::sort(tokens.begin(), tokens.end(), [](const std::string& a, const std::string& b) {
+            return a.size() > b.size();
+        });
+
+        return tokens;
+    }
+}
+
+void PresetSearchIndex::clear()
+{
+    entries.clear();
+    text.clear();
+    postings.clear();
+    results.clear();
+    candidates.clear();
+}
+
+void PresetSearchIndex::beginEntry(int itemId, const juce::String& displayText)
+{
+    auto start = (juce::uint32)text.size();
+    entries.push_back({ itemId, displayText, start, start });
+    addText(displayText);
+    entries.back().titleEnd = (juce::uint32)text.size();
+}
+
+void PresetSearchIndex::addText(const char* utf8)
+{
+    for (auto* p = utf8; *p != 0; ++p)
+        text.push_back(foldCase(*p));
+
+    text.push_back(fieldSeparator);
+}
+
+void PresetSearchIndex::addText(const juce::String& textToAdd)
+{
+    addText(textToAdd.toRawUTF8());
+}
+
+std::string_view PresetSearchIndex::getEntryText(int entryIndex) const
+{
+    auto start = entries[(size_t)entryIndex].textStart;
+    auto end = entryIndex + 1 < (int)entries.size() ? entries[(size_t)entryIndex + 1].textStart
+                                                    : (juce::uint32)text.size();
+    return { text.data() + start, (size_t)(end - start) };
+}
+
+void PresetSearchIndex::build()
+{
+    postings.clear();
+
+    for (int e = 0; e < (int)entries.size(); ++e)
+    {
+        auto entryText = getEntryText(e);
+
+        for (size_t i = 0; i + 3 <= entryText.size(); ++i)
+        {
+            auto* p = entryText.data() + i;
+            if (isSeparator(p[0]) || isSeparator(p[1]) || isSeparator(p[2]))
+                continue;
+
+            auto& list = postings[trigramKey(p)];
+            if (list.empty() || list.back() != e)
+                list.push_back(e);
+        }
+    }
+
+    auto numEntries = entries.size();
+    hitCounts.assign(numEntries, 0);
+    marks.assign(numEntries, 0);
+    scores.assign(numEntries, 0);
+    generation = 0;
+
+    results.reserve(numEntries);
+    candidates.reserve(numEntries);
+    nextCandidates.reserve(numEntries);
+    touched.reserve(numEntries);
+}
+
+int PresetSearchIndex::scoreToken(int entryIndex, std::string_view token, int trigramHits, int trigramsNeeded) const
+{
+    auto entryText = getEntryText(entryIndex);
+    auto pos = entryText.find(token);
+
+    if (pos != std::string_view::npos)
+    {
+        int score = 100;
+
+        if (pos == 0 || isSeparator(entryText[pos - 1]))
+            score += 50;
+
+        if (pos < entries[(size_t)entryIndex].titleEnd - entries[(size_t)entryIndex].textStart)
+            score += 25;
+
+        return score;
+    }
+
+    if (trigramsNeeded > 0 && trigramHits >= trigramsNeeded)
+        return 10 * trigramHits;
+
+    return 0;
+}
+
+const std::vector<int>& PresetSearchIndex::search(const juce::String& query)
+{
+    results.clear();
+
+    auto tokens = tokenise(query);
+    auto numEntries = (int)entries.size();
+
+    if (tokens.empty())
+    {
+        for (int e = 0; e < numEntries; ++e)
+            results.push_back(e);
+
+        return results;
+    }
+
+    bool restricted = false;
+    candidates.clear();
+
+    for (const auto& tokenString : tokens)
+    {
+        std::string_view token(tokenString);
+        nextCandidates.clear();
+
+        auto accept = [this, restricted](int e, int tokenScore) {
+            scores[(size_t)e] = (restricted ? scores[(size_t)e] : 0) + tokenScore;
+            nextCandidates.push_back(e);
+        };
+
+        if (token.size() >= 3)
+        {
+            std::vector<juce::uint32> keys;
+            for (size_t i = 0; i + 3 <= token.size(); ++i)
+            {
+                auto key = trigramKey(token.data() + i);
+                if (std::find(keys.begin(), keys.end(), key) == keys.end())
+                    keys.push_back(key);
+            }
+
+            touched.clear();
+            for (auto key : keys)
+            {
+                auto found = postings.find(key);
+                if (found == postings.end())
+                    continue;
+
+                for (auto e : found->second)
+                {
+                    if (hitCounts[(size_t)e]++ == 0)
+                        touched.push_back(e);
+                }
+            }
+
+            int trigramsNeeded = token.size() == 3 ? 1 : juce::jmax(1, ((int)keys.size() + 1) / 2);
+
+            for (auto e : touched)
+            {
+                int hits = hitCounts[(size_t)e];
+                hitCounts[(size_t)e] = 0;
+
+                if (restricted && marks[(size_t)e] != generation)
+                    continue;
+
+                if (auto tokenScore = scoreToken(e, token, hits, trigramsNeeded))
+                    accept(e, tokenScore);
+            }
+        }
+        else if (restricted)
+        {
+            for (auto e : candidates)
+                if (auto tokenScore = scoreToken(e, token, 0, 0))
+                    accept(e, tokenScore);
+        }
+        else
+        {
+            for (int e = 0; e < numEntries; ++e)
+                if (auto tokenScore = scoreToken(e, token, 0, 0))
+                    accept(e, tokenScore);
+        }
+
+        if (++generation == 0)
+        {
+            std::fill(marks.begin(), marks.end(), 0);
+            generation = 1;
+        }
+
+        for (auto e : nextCandidates)
+            marks[(size_t)e] = generation;
+
+        candidates.swap(nextCandidates);
+        restricted = true;
+
+        if (candidates.empty())
+            break;
+    }
+
+    results.assign(candidates.begin(), candidates.end());
+    std::sort(results.begin(), results.end(), [this](int a, int b) {
+        if (scores[(size_t)a] != scores[(size_t)b])
+            return scores[(size_t)a] > scores[(size_t)b];
+        return a < b;
+    });
+
+    return results;
+}
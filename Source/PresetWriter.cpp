@@ -0,0 +1,114 @@
+#include "PresetWriter.h"
+
+PresetWriter::PresetWriter()
+    : juce::Thread("SimpleCC Preset Writer")
+{
+    startThread(juce::Thread::Priority::background);
+}
+
+PresetWriter::~PresetWriter()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(10000);
+    cancelPendingUpdate();
+}
+
+void PresetWriter::write(const juce::File& file, const juce::String& content)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        pending[file.getFullPathName()] = { file, content };
+    }
+
+    notify();
+}
+
+bool PresetWriter::isBusy() const
+{
+    const juce::ScopedLock sl(lock);
+    return writing || !pending.empty();
+}
+
+void PresetWriter::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+
+        if (!threadShouldExit())
+            wait(coalesceDelayMs);
+
+        writePending();
+    }
+
+    writePending();
+}
+
+void PresetWriter::writePending()
+{
+    for (;;)
+    {
+        std::pair<juce::File, juce::String> job;
+
+        {
+            const juce::ScopedLock sl(lock);
+
+            if (pending.empty())
+            {
+                writing = false;
+                return;
+            }
+
+            auto next = pending.begin();
+            job = std::move(next->second);
+            pending.erase(next);
+            writing = true;
+        }
+
+        bool succeeded = writeAtomically(job.first, job.second);
+
+        {
+            const juce::ScopedLock sl(lock);
+            finished.push_back({ job.first, succeeded });
+        }
+
+        triggerAsyncUpdate();
+    }
+}
+
+bool PresetWriter::writeAtomically(const juce::File& file, const juce::String& content)
+{
+    auto directory = file.getParentDirectory();
+    if (!directory.exists() && directory.createDirectory().failed())
+        return false;
+
+    juce::TemporaryFile temp(file, juce::TemporaryFile::useHiddenFile);
+
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk())
+            return false;
+
+        out.writeText(content, false, false, nullptr);
+        out.flush();
+
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+void PresetWriter::handleAsyncUpdate()
+{
+    std::vector<std::pair<juce::File, bool>> results;
+
+    {
+        const juce::ScopedLock sl(lock);
+        results.swap(finished);
+    }
+
+    for (const auto& result : results)
+        listeners.call([&result](Listener& l) { l.presetWriteFinished(result.first, result.second); });
+}
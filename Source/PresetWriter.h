@@ -0,0 +1,49 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+// Background writer for user preset files.
+//
+// write() only queues the text and returns; a worker thread writes each file
+// to a temporary sibling and renames it over the target, so a crash mid-write
+// never leaves a truncated preset. Requests for the same file that arrive
+// before the worker picks them up replace each other, and listeners are told
+// about every finished write on the message thread.
+
+class PresetWriter : private juce::Thread,
+                     private juce::AsyncUpdater
+{
+public:
+    struct Listener
+    {
+        virtual ~Listener() = default;
+        virtual void presetWriteFinished(const juce::File& file, bool succeeded) = 0;
+    };
+
+    PresetWriter();
+    ~PresetWriter() override;
+
+    void write(const juce::File& file, const juce::String& content);
+    bool isBusy() const;
+
+    void addListener(Listener* listener) { listeners.add(listener); }
+    void removeListener(Listener* listener) { listeners.remove(listener); }
+
+private:
+    void run() override;
+    void handleAsyncUpdate() override;
+    void writePending();
+    static bool writeAtomically(const juce::File& file, const juce::String& content);
+
+    static constexpr int coalesceDelayMs = 100;
+
+    juce::CriticalSection lock;
+    std::map<juce::String, std::pair<juce::File, juce::String>> pending;
+    std::vector<std::pair<juce::File, bool>> finished;
+    bool writing = false;
+
+    juce::ListenerList<Listener> listeners;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetWriter)
+};
@@ -0,0 +1,116 @@
+#include "RealtimeCheck.h"
+
+#include <atomic>
+#include <cstddef>
+
+namespace
+{
+    constexpr int tableSize = 512;
+
+    struct Entry
+    {
+        std::atomic<std::uintptr_t> key { 0 };
+        std::atomic<std::uint64_t> count { 0 };
+    };
+
+    Entry table[tableSize];
+    std::atomic<std::uint64_t> dropped { 0 };
+
+    thread_local bool insideRealtimeScope = false;
+
+    // The kind takes the low three bits and the call site the rest; user
+    // space addresses leave the top bits free, so nothing is lost. 0 marks an
+    // empty entry, hence the + 1.
+    std::uintptr_t makeKey(int kind, const void* callSite)
+    {
+        return ((reinterpret_cast<std::uintptr_t>(callSite) << 3) | (std::uintptr_t)kind) + 1;
+    }
+}
+
+namespace RealtimeCheck
+{
+    const char* getKindName(int kind)
+    {
+        static const char* const names[numKinds] = {
+            "malloc", "calloc", "realloc", "free", "operator new", "operator delete", "mutex lock"
+        };
+
+        return kind >= 0 && kind < numKinds ? names[kind] : "unknown";
+    }
+
+    ScopedRealtimeThread::ScopedRealtimeThread()
+        : wasInside(insideRealtimeScope)
+    {
+        insideRealtimeScope = true;
+    }
+
+    ScopedRealtimeThread::~ScopedRealtimeThread()
+    {
+        insideRealtimeScope = wasInside;
+    }
+
+    bool isInsideRealtimeScope() noexcept
+    {
+        return insideRealtimeScope;
+    }
+
+    void recordViolation(int kind, const void* callSite) noexcept
+    {
+        auto key = makeKey(kind, callSite);
+        auto index = (std::size_t)((key * 0x9e3779b97f4a7c15ull) >> 32) % tableSize;
+
+        for (int probe = 0; probe < tableSize; ++probe)
+        {
+            auto& entry = table[(index + (std::size_t)probe) % tableSize];
+            auto existing = entry.key.load(std::memory_order_acquire);
+
+            if (existing == 0 && entry.key.compare_exchange_strong(existing, key, std::memory_order_acq_rel))
+                existing = key;
+
+            if (existing == key)
+            {
+                entry.count.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t getNumDroppedViolations() noexcept
+    {
+        return dropped.load();
+    }
+
+    std::vector<Violation> getViolations()
+    {
+        std::vector<Violation> violations;
+
+        for (auto& entry : table)
+        {
+            auto key = entry.key.load(std::memory_order_acquire);
+
+            if (key == 0)
+                continue;
+
+            Violation violation;
+            violation.kind = (int)((key - 1) & 7);
+            violation.callSite = reinterpret_cast<const void*>((key - 1) >> 3);
+            violation.count = entry.count.load();
+            violations.push_back(violation);
+        }
+
+        return violations;
+    }
+
+    void reset()
+    {
+        for (auto& entry : table)
+        {
+            entry.key.store(0);
+            entry.count.store(0);
+        }
+
+        dropped.store(0);
+    }
+}
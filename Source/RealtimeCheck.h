@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Real-time safety instrumentation, compiled in with SIMPLECC_RT_CHECKS.
+//
+// processBlock marks the audio thread with SIMPLECC_REALTIME_SCOPE. Allocator
+// and mutex hooks (Tests/RealtimeHooks.cpp, linked only into the check
+// harness) ask isInsideRealtimeScope() and, if so, record the call with the
+// address it came from. Recording goes into a fixed table of atomics, so the
+// hooks themselves never allocate or lock.
+
+namespace RealtimeCheck
+{
+    enum Kind
+    {
+        kindMalloc = 0,
+        kindCalloc,
+        kindRealloc,
+        kindFree,
+        kindOperatorNew,
+        kindOperatorDelete,
+        kindMutexLock,
+        numKinds
+    };
+
+    const char* getKindName(int kind);
+
+    struct Violation
+    {
+        int kind = kindMalloc;
+        const void* callSite = nullptr;
+        std::uint64_t count = 0;
+    };
+
+    class ScopedRealtimeThread
+    {
+    public:
+        ScopedRealtimeThread();
+        ~ScopedRealtimeThread();
+
+    private:
+        bool wasInside;
+    };
+
+    bool isInsideRealtimeScope() noexcept;
+
+    void recordViolation(int kind, const void* callSite) noexcept;
+
+    // Call sites that did not fit in the table are still counted here.
+    std::uint64_t getNumDroppedViolations() noexcept;
+
+    std::vector<Violation> getViolations();
+    void reset();
+}
+
+#if SIMPLECC_RT_CHECKS
+ #define SIMPLECC_REALTIME_SCOPE const RealtimeCheck::ScopedRealtimeThread simplecc_realtimeScope
+#else
+ #define SIMPLECC_REALTIME_SCOPE
+#endif
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// The MIDI messages a slot can send, and a table-driven encoder that writes
+// their raw bytes without going through juce::MidiMessage.
+//
+// Every type is described by its status nibble, whether it carries a number
+// (controller or note) before the value, and whether the value is 7 or 14
+// bits wide, so encode() is the same handful of stores for all of them.
+//
+// A 14-bit controller is the MIDI 1.0 high-resolution form: the MSB on
+// controller 0-31 followed by the LSB on the same number plus 32. It is
+// evaluated and deduplicated at 14 bits like pitch bend, so a change that
+// only moves the LSB still goes out.
+
+namespace SlotMessage
+{
+    enum Type
+    {
+        controlChange = 0,
+        pitchBend,
+        channelPressure,
+        polyAftertouch,
+        programChange,
+        controlChange14,
+        numTypes
+    };
+
+    struct Encoding
+    {
+        juce::uint8 status;
+        bool hasNumber;
+        bool fourteenBit;
+        const char* name;
+    };
+
+    constexpr Encoding encodings[numTypes] = {
+        { 0xb0, true,  false, "CC" },
+        { 0xe0, false, true,  "Bend" },
+        { 0xd0, false, false, "Pressure" },
+        { 0xa0, true,  false, "Poly AT" },
+        { 0xc0, false, false, "Program" },
+        { 0xb0, true,  true,  "CC 14-bit" }
+    };
+
+    // Longest encode() output: a 14-bit controller's two control changes.
+    constexpr int maxEncodedSize = 6;
+
+    inline int getMaxValue(int type)
+    {
+        return encodings[type].fourteenBit ? 16383 : 127;
+    }
+
+    inline bool usesNumber(int type)
+    {
+        return encodings[type].hasNumber;
+    }
+
+    // Only controllers 0-31 have an LSB partner.
+    inline int getMaxNumber(int type)
+    {
+        return type == controlChange14 ? 31 : 127;
+    }
+
+    // Writes at most maxEncodedSize bytes and returns how many were written.
+    // Every message but a 14-bit controller's pair is one message of up to
+    // three bytes.
+    inline int encode(int type, int channel, int number, int value, juce::uint8* out)
+    {
+        const auto& encoding = encodings[type];
+        int size = 0;
+
+        out[size++] = (juce::uint8)(encoding.status | ((channel - 1) & 0x0f));
+
+        if (type == controlChange14)
+        {
+            out[size++] = (juce::uint8)(number & 0x1f);
+            out[size++] = (juce::uint8)((value >> 7) & 0x7f);
+            out[size++] = out[0];
+            out[size++] = (juce::uint8)((number & 0x1f) + 32);
+            out[size++] = (juce::uint8)(value & 0x7f);
+            return size;
+        }
+
+        if (encoding.hasNumber)
+            out[size++] = (juce::uint8)(number & 0x7f);
+
+        if (encoding.fourteenBit)
+        {
+            out[size++] = (juce::uint8)(value & 0x7f);
+            out[size++] = (juce::uint8)((value >> 7) & 0x7f);
+        }
+        else
+        {
+            out[size++] = (juce::uint8)(value & 0x7f);
+        }
+
+        return size;
+    }
+
+    // Every (type, channel, number) a slot can send maps to one key: numbered
+    // types get 16 x 128 keys each, the rest one key per channel, and 14-bit
+    // controllers 16 x 32 after them.
+    constexpr int numDestinationKeys = 2 * 16 * 128 + 3 * 16 + 16 * 32;
+
+    inline int getDestinationKey(int type, int channel, int number)
+    {
+        int ch = (channel - 1) & 0x0f;
+
+        switch (type)
+        {
+            case polyAftertouch:  return 2048 + ch * 128 + (number & 0x7f);
+            case pitchBend:       return 4096 + ch;
+            case channelPressure: return 4112 + ch;
+            case programChange:   return 4128 + ch;
+            case controlChange14: return 4144 + ch * 32 + (number & 0x1f);
+            default:              return ch * 128 + (number & 0x7f);
+        }
+    }
+
+    inline void decodeDestinationKey(int key, int& type, int& channel, int& number)
+    {
+        number = 0;
+
+        if (key < 4096)
+        {
+            type = key < 2048 ? controlChange : polyAftertouch;
+            channel = ((key & 2047) >> 7) + 1;
+            number = key & 0x7f;
+        }
+        else if (key >= 4144)
+        {
+            type = controlChange14;
+            channel = ((key - 4144) >> 5) + 1;
+            number = (key - 4144) & 0x1f;
+        }
+        else
+        {
+            const int perChannelTypes[] = { pitchBend, channelPressure, programChange };
+            type = perChannelTypes[(key - 4096) / 16];
+            channel = (key - 4096) % 16 + 1;
+        }
+    }
+}
@@ -0,0 +1,516 @@
+#include "StateChunk.h"
+
+namespace
+{
+    constexpr char stateMagic[4] = { 'S', 'C', 'C', 'S' };
+    constexpr juce::uint8 presetIsUserFlag = 0x01;
+    constexpr juce::uint8 slotEnabledFlag = 0x01;
+    constexpr juce::uint8 refreshOnTransportStartFlag = 0x01;
+    constexpr size_t maxStringBytes = 0xffff;
+
+    size_t stringBytes(const juce::String& text)
+    {
+        return juce::jmin(text.getNumBytesAsUTF8(), maxStringBytes);
+    }
+
+    void writeUInt16(juce::uint8* p, juce::uint32 value)
+    {
+        p[0] = (juce::uint8)(value & 0xff);
+        p[1] = (juce::uint8)((value >> 8) & 0xff);
+    }
+
+    void writeUInt32(juce::uint8* p, juce::uint32 value)
+    {
+        p[0] = (juce::uint8)(value & 0xff);
+        p[1] = (juce::uint8)((value >> 8) & 0xff);
+        p[2] = (juce::uint8)((value >> 16) & 0xff);
+        p[3] = (juce::uint8)((value >> 24) & 0xff);
+    }
+
+    void writeFloat(juce::uint8* p, float value)
+    {
+        juce::uint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeUInt32(p, bits);
+    }
+
+    float readFloat(const juce::uint8* p)
+    {
+        auto bits = juce::ByteOrder::littleEndianInt(p);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    juce::uint8* writeString(juce::uint8* p, const juce::String& text)
+    {
+        auto numBytes = stringBytes(text);
+        writeUInt16(p, (juce::uint32)numBytes);
+        std::memcpy(p + 2, text.toRawUTF8(), numBytes);
+        return p + 2 + numBytes;
+    }
+
+    bool readString(const juce::uint8*& p, const juce::uint8* end, juce::String& result)
+    {
+        if (end - p < 2)
+            return false;
+
+        auto numBytes = (size_t)juce::ByteOrder::littleEndianShort(p);
+        p += 2;
+
+        if ((size_t)(end - p) < numBytes)
+            return false;
+
+        result = juce::String::fromUTF8(reinterpret_cast<const char*>(p), (int)numBytes);
+        p += numBytes;
+        return true;
+    }
+
+    size_t getSlotsSize(const std::vector<StateChunk::Slot>& slots, size_t numSlots)
+    {
+        size_t size = numSlots * (size_t)StateChunk::slotRecordSize;
+
+        for (size_t i = 0; i < numSlots; ++i)
+            size += 2 + stringBytes(slots[i].name);
+
+        return size;
+    }
+
+    juce::uint8* writeSlots(juce::uint8* p, const std::vector<StateChunk::Slot>& slots, size_t numSlots)
+    {
+        for (size_t i = 0; i < numSlots; ++i)
+        {
+            const auto& slot = slots[i];
+
+            p[0] = (juce::uint8)(juce::int8)juce::jlimit(-1, 127, slot.ccNumber);
+            p[1] = (juce::uint8)juce::jlimit(1, 16, slot.midiChannel);
+            p[2] = slot.enabled ? slotEnabledFlag : 0;
+            p[3] = (juce::uint8)juce::jlimit(0, 255, slot.messageType);
+            writeFloat(p + 4, slot.value);
+            p += StateChunk::slotRecordSize;
+        }
+
+        for (size_t i = 0; i < numSlots; ++i)
+            p = writeString(p, slots[i].name);
+
+        return p;
+    }
+
+    // Reads numSlots records and names, keeping only as many as the destination holds.
+    bool readSlots(const juce::uint8*& p, const juce::uint8* end, size_t numSlots, std::vector<StateChunk::Slot>& slots)
+    {
+        if ((size_t)(end - p) < numSlots * (size_t)StateChunk::slotRecordSize)
+            return false;
+
+        auto numToRead = juce::jmin(numSlots, slots.size());
+
+        for (size_t i = 0; i < numToRead; ++i)
+        {
+            auto* record = p + i * (size_t)StateChunk::slotRecordSize;
+            auto& slot = slots[i];
+
+            slot.ccNumber = (int)(juce::int8)record[0];
+            slot.midiChannel = juce::jlimit(1, 16, (int)record[1]);
+            slot.enabled = (record[2] & slotEnabledFlag) != 0;
+            slot.messageType = record[3];
+            slot.value = juce::jlimit(0.0f, 1.0f, readFloat(record + 4));
+        }
+
+        p += numSlots * (size_t)StateChunk::slotRecordSize;
+        juce::String ignored;
+
+        for (size_t i = 0; i < numSlots; ++i)
+        {
+            if (!readString(p, end, i < numToRead ? slots[i].name : ignored))
+                return false;
+        }
+
+        return true;
+    }
+
+    size_t getMacroDestinationsPerMacro(const StateChunk::State& state)
+    {
+        size_t numDestinations = 0;
+
+        for (const auto& macro : state.macros)
+            numDestinations = juce::jmax(numDestinations, macro.destinations.size());
+
+        return juce::jmin(numDestinations, (size_t)0xff);
+    }
+
+    // Everything after the slots and preset, as a session that never set it.
+    void resetToDefaults(StateChunk::State& state)
+    {
+        state.userPreset = {};
+        state.currentProgram = 0;
+        state.programChangeChannel = -1;
+        state.programs.clear();
+        state.morphMode = 0;
+        state.morphX = 0.0f;
+        state.morphY = 0.0f;
+        state.snapshots.clear();
+        state.macros.clear();
+        state.mergePolicy = 0;
+        state.refreshOnTransportStart = false;
+        state.keepAliveSeconds = 0;
+        state.lookaheadMs = 0;
+        state.slotSources.clear();
+        state.slotGridDivisions.clear();
+    }
+}
+
+namespace StateChunk
+{
+
+    size_t getBinarySize(const State& state)
+    {
+        auto numSlots = juce::jmin(state.slots.size(), (size_t)0xffff);
+        size_t size = (size_t)headerSize + getSlotsSize(state.slots, numSlots);
+
+        size += 2 + stringBytes(state.presetManufacturer);
+        size += 2 + stringBytes(state.presetName);
+
+        size += 6;
+        for (const auto& program : state.programs)
+            size += 4 + 2 + stringBytes(program.name) + getSlotsSize(program.slots, juce::jmin(program.slots.size(), (size_t)0xffff));
+
+        size += 12 + juce::jmin(state.snapshots.size(), (size_t)0xff) * numSlots * sizeof(float);
+
+        size += 4 + juce::jmin(state.macros.size(), (size_t)0xff) * (sizeof(float) + getMacroDestinationsPerMacro(state) * (size_t)macroDestinationRecordSize);
+        size += 12;
+        size += 4 + juce::jmin(state.slotSources.size(), (size_t)0xff) * 4;
+        size += 4 + juce::jmin(state.slotGridDivisions.size(), (size_t)0xff);
+        return size;
+    }
+
+    void writeBinary(const State& state, juce::MemoryBlock& destData)
+    {
+        auto size = getBinarySize(state);
+        auto numSlots = juce::jmin(state.slots.size(), (size_t)0xffff);
+
+        destData.setSize(size, false);
+        auto* p = static_cast<juce::uint8*>(destData.getData());
+
+        std::memcpy(p, stateMagic, sizeof(stateMagic));
+        writeUInt16(p + 4, binaryVersion);
+        writeUInt16(p + 6, (juce::uint32)numSlots);
+        writeUInt32(p + 8, (juce::uint32)size);
+        p[12] = state.presetIsUser ? presetIsUserFlag : 0;
+        p[13] = p[14] = p[15] = 0;
+        p += headerSize;
+
+        p = writeSlots(p, state.slots, numSlots);
+        p = writeString(p, state.presetManufacturer);
+        p = writeString(p, state.presetName);
+
+        writeUInt16(p, (juce::uint32)juce::jmax(0, state.currentProgram));
+        p[2] = (juce::uint8)(juce::int8)juce::jlimit(-1, 16, state.programChangeChannel);
+        p[3] = 0;
+        writeUInt16(p + 4, (juce::uint32)juce::jmin(state.programs.size(), (size_t)0xffff));
+        p += 6;
+
+        for (const auto& program : state.programs)
+        {
+            auto numProgramSlots = juce::jmin(program.slots.size(), (size_t)0xffff);
+            writeUInt16(p, (juce::uint32)juce::jmax(0, program.index));
+            writeUInt16(p + 2, (juce::uint32)numProgramSlots);
+            p = writeString(p + 4, program.name);
+            p = writeSlots(p, program.slots, numProgramSlots);
+        }
+
+        auto numSnapshots = juce::jmin(state.snapshots.size(), (size_t)0xff);
+        p[0] = (juce::uint8)juce::jlimit(0, 255, state.morphMode);
+        p[1] = (juce::uint8)numSnapshots;
+        writeUInt16(p + 2, (juce::uint32)numSlots);
+        writeFloat(p + 4, state.morphX);
+        writeFloat(p + 8, state.morphY);
+        p += 12;
+
+        for (size_t s = 0; s < numSnapshots; ++s)
+        {
+            const auto& values = state.snapshots[s];
+
+            for (size_t i = 0; i < numSlots; ++i)
+            {
+                writeFloat(p, i < values.size() ? values[i] : 0.0f);
+                p += sizeof(float);
+            }
+        }
+
+        auto numMacros = juce::jmin(state.macros.size(), (size_t)0xff);
+        auto destinationsPerMacro = getMacroDestinationsPerMacro(state);
+        p[0] = (juce::uint8)numMacros;
+        p[1] = (juce::uint8)destinationsPerMacro;
+        p[2] = p[3] = 0;
+        p += 4;
+
+        for (size_t m = 0; m < numMacros; ++m)
+        {
+            const auto& macro = state.macros[m];
+            writeFloat(p, macro.value);
+            p += sizeof(float);
+
+            for (size_t d = 0; d < destinationsPerMacro; ++d)
+            {
+                MacroDestination destination;
+                if (d < macro.destinations.size())
+                    destination = macro.destinations[d];
+
+                p[0] = (juce::uint8)(juce::int8)juce::jlimit(-1, 127, destination.ccNumber);
+                p[1] = (juce::uint8)juce::jlimit(1, 16, destination.midiChannel);
+                p[2] = destination.enabled ? slotEnabledFlag : 0;
+                p[3] = (juce::uint8)juce::jlimit(0, 255, destination.curve);
+                p[4] = (juce::uint8)juce::jlimit(0, 127, destination.minValue);
+                p[5] = (juce::uint8)juce::jlimit(0, 127, destination.maxValue);
+                p[6] = p[7] = 0;
+                p += macroDestinationRecordSize;
+            }
+        }
+
+        p[0] = (juce::uint8)juce::jlimit(0, 255, state.mergePolicy);
+        p[1] = p[2] = p[3] = 0;
+        p += 4;
+
+        p[0] = state.refreshOnTransportStart ? refreshOnTransportStartFlag : 0;
+        p[1] = 0;
+        writeUInt16(p + 2, (juce::uint32)juce::jlimit(0, 0xffff, state.keepAliveSeconds));
+        p += 4;
+
+        writeUInt16(p, (juce::uint32)juce::jlimit(0, 0xffff, state.lookaheadMs));
+        p[2] = p[3] = 0;
+        p += 4;
+
+        auto numSources = juce::jmin(state.slotSources.size(), (size_t)0xff);
+        p[0] = (juce::uint8)numSources;
+        p[1] = p[2] = p[3] = 0;
+        p += 4;
+
+        for (size_t i = 0; i < numSources; ++i)
+        {
+            p[0] = (juce::uint8)juce::jlimit(0, 255, state.slotSources[i].type);
+            p[1] = (juce::uint8)juce::jlimit(0, 127, state.slotSources[i].ccNumber);
+            p[2] = p[3] = 0;
+            p += 4;
+        }
+
+        auto numGridDivisions = juce::jmin(state.slotGridDivisions.size(), (size_t)0xff);
+        p[0] = (juce::uint8)numGridDivisions;
+        p[1] = p[2] = p[3] = 0;
+        p += 4;
+
+        for (size_t i = 0; i < numGridDivisions; ++i)
+            *p++ = (juce::uint8)juce::jlimit(0, 255, state.slotGridDivisions[i]);
+    }
+
+    bool isBinary(const void* data, int sizeInBytes)
+    {
+        return data != nullptr && sizeInBytes >= headerSize
+            && std::memcmp(data, stateMagic, sizeof(stateMagic)) == 0;
+    }
+
+    bool readBinary(const void* data, int sizeInBytes, State& state)
+    {
+        if (!isBinary(data, sizeInBytes))
+            return false;
+
+        auto* p = static_cast<const juce::uint8*>(data);
+        auto version = juce::ByteOrder::littleEndianShort(p + 4);
+        auto numSlots = (size_t)juce::ByteOrder::littleEndianShort(p + 6);
+        auto totalSize = (size_t)juce::ByteOrder::littleEndianInt(p + 8);
+        auto flags = p[12];
+
+        if (version != binaryVersion || totalSize > (size_t)sizeInBytes || totalSize < (size_t)headerSize)
+            return false;
+
+        auto* end = p + totalSize;
+        const juce::uint8* cursor = p + headerSize;
+
+        if (!readSlots(cursor, end, numSlots, state.slots))
+            return false;
+
+        if (!readString(cursor, end, state.presetManufacturer) || !readString(cursor, end, state.presetName))
+            return false;
+
+        state.presetIsUser = (flags & presetIsUserFlag) != 0;
+        resetToDefaults(state);
+
+        if (end - cursor < 6)
+            return false;
+
+        state.currentProgram = (int)juce::ByteOrder::littleEndianShort(cursor);
+        state.programChangeChannel = juce::jlimit(-1, 16, (int)(juce::int8)cursor[2]);
+        auto numPrograms = (size_t)juce::ByteOrder::littleEndianShort(cursor + 4);
+        cursor += 6;
+
+        for (size_t i = 0; i < numPrograms; ++i)
+        {
+            if (end - cursor < 4)
+                return false;
+
+            Program program;
+            program.index = (int)juce::ByteOrder::littleEndianShort(cursor);
+            auto numProgramSlots = (size_t)juce::ByteOrder::littleEndianShort(cursor + 2);
+            cursor += 4;
+
+            program.slots.resize(numProgramSlots);
+
+            if (!readString(cursor, end, program.name) || !readSlots(cursor, end, numProgramSlots, program.slots))
+                return false;
+
+            state.programs.push_back(std::move(program));
+        }
+
+        if (end - cursor < 12)
+            return false;
+
+        state.morphMode = cursor[0];
+        auto numSnapshots = (size_t)cursor[1];
+        auto valuesPerSnapshot = (size_t)juce::ByteOrder::littleEndianShort(cursor + 2);
+        state.morphX = juce::jlimit(0.0f, 1.0f, readFloat(cursor + 4));
+        state.morphY = juce::jlimit(0.0f, 1.0f, readFloat(cursor + 8));
+        cursor += 12;
+
+        if ((size_t)(end - cursor) < numSnapshots * valuesPerSnapshot * sizeof(float))
+            return false;
+
+        state.snapshots.resize(numSnapshots);
+
+        for (auto& values : state.snapshots)
+        {
+            values.resize(valuesPerSnapshot);
+
+            for (auto& value : values)
+            {
+                value = juce::jlimit(0.0f, 1.0f, readFloat(cursor));
+                cursor += sizeof(float);
+            }
+        }
+
+        if (end - cursor < 4)
+            return false;
+
+        auto numMacros = (size_t)cursor[0];
+        auto destinationsPerMacro = (size_t)cursor[1];
+        cursor += 4;
+
+        if ((size_t)(end - cursor) < numMacros * (sizeof(float) + destinationsPerMacro * (size_t)macroDestinationRecordSize))
+            return false;
+
+        state.macros.resize(numMacros);
+
+        for (auto& macro : state.macros)
+        {
+            macro.value = juce::jlimit(0.0f, 1.0f, readFloat(cursor));
+            cursor += sizeof(float);
+            macro.destinations.resize(destinationsPerMacro);
+
+            for (auto& destination : macro.destinations)
+            {
+                destination.ccNumber = (int)(juce::int8)cursor[0];
+                destination.midiChannel = juce::jlimit(1, 16, (int)cursor[1]);
+                destination.enabled = (cursor[2] & slotEnabledFlag) != 0;
+                destination.curve = cursor[3];
+                destination.minValue = juce::jlimit(0, 127, (int)cursor[4]);
+                destination.maxValue = juce::jlimit(0, 127, (int)cursor[5]);
+                cursor += macroDestinationRecordSize;
+            }
+        }
+
+        if (end - cursor < 12)
+            return false;
+
+        state.mergePolicy = cursor[0];
+        state.refreshOnTransportStart = (cursor[4] & refreshOnTransportStartFlag) != 0;
+        state.keepAliveSeconds = (int)juce::ByteOrder::littleEndianShort(cursor + 6);
+        state.lookaheadMs = (int)juce::ByteOrder::littleEndianShort(cursor + 8);
+        cursor += 12;
+
+        if (end - cursor < 4 || (size_t)(end - cursor - 4) < (size_t)cursor[0] * 4)
+            return false;
+
+        state.slotSources.resize(cursor[0]);
+        cursor += 4;
+
+        for (auto& source : state.slotSources)
+        {
+            source.type = cursor[0];
+            source.ccNumber = cursor[1] & 0x7f;
+            cursor += 4;
+        }
+
+        if (end - cursor < 4 || (size_t)(end - cursor - 4) < (size_t)cursor[0])
+            return false;
+
+        state.slotGridDivisions.resize(cursor[0]);
+        cursor += 4;
+
+        for (auto& division : state.slotGridDivisions)
+            division = *cursor++;
+
+        return true;
+    }
+
+    std::unique_ptr<juce::XmlElement> createXml(const State& state)
+    {
+        auto xml = std::make_unique<juce::XmlElement>("SimpleCCState");
+
+        for (int i = 0; i < (int)state.slots.size(); ++i)
+        {
+            const auto& slot = state.slots[(size_t)i];
+            auto* slotXml = xml->createNewChildElement("Slot");
+            slotXml->setAttribute("index", i);
+            slotXml->setAttribute("cc", slot.ccNumber);
+            slotXml->setAttribute("channel", slot.midiChannel);
+            slotXml->setAttribute("enabled", slot.enabled);
+            slotXml->setAttribute("name", slot.name);
+            slotXml->setAttribute("value", slot.value);
+        }
+
+        if (state.userPreset.isNotEmpty())
+            xml->setAttribute("userPreset", state.userPreset);
+
+        if (state.presetManufacturer.isNotEmpty())
+            xml->setAttribute("currentPresetManufacturer", state.presetManufacturer);
+        if (state.presetName.isNotEmpty())
+            xml->setAttribute("currentPresetName", state.presetName);
+        xml->setAttribute("isCurrentPresetUser", state.presetIsUser);
+
+        return xml;
+    }
+
+    bool readXml(const juce::XmlElement& xml, State& state)
+    {
+        if (!xml.hasTagName("SimpleCCState"))
+            return false;
+
+        // 1.0 predates everything but the slots and preset, and every slot
+        // it wrote sent control change.
+        resetToDefaults(state);
+
+        for (auto& slot : state.slots)
+            slot.messageType = 0;
+
+        for (auto* slotXml : xml.getChildIterator())
+        {
+            if (slotXml->hasTagName("Slot"))
+            {
+                int index = slotXml->getIntAttribute("index", -1);
+                if (index >= 0 && index < (int)state.slots.size())
+                {
+                    auto& slot = state.slots[(size_t)index];
+                    slot.ccNumber = slotXml->getIntAttribute("cc", -1);
+                    slot.midiChannel = slotXml->getIntAttribute("channel", 1);
+                    slot.enabled = slotXml->getBoolAttribute("enabled", index == 0);
+                    slot.name = slotXml->getStringAttribute("name", "Slot " + juce::String(index + 1));
+                    slot.value = (float)slotXml->getDoubleAttribute("value", 0.0);
+                }
+            }
+        }
+
+        state.userPreset = xml.getStringAttribute("userPreset", "");
+        state.presetManufacturer = xml.getStringAttribute("currentPresetManufacturer", "");
+        state.presetName = xml.getStringAttribute("currentPresetName", "");
+        state.presetIsUser = xml.getBoolAttribute("isCurrentPresetUser", false);
+        return true;
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Plugin state as handed to the host by getStateInformation.
+//
+// The binary chunk is a 16 byte header (magic "SCCS", version, slot count,
+// total size, flags), one 8 byte record per slot (cc, channel, flags, message
+// type, value)
+// and then length-prefixed UTF-8 strings: every slot name followed by the
+// current preset's manufacturer and name. After that come, in order:
+//   Programs     the current program, the program change receive channel and
+//                every program that differs from the default, each stored as
+//                name, slot records and slot names.
+//   Morph        mode, X/Y position and the value of every slot in each
+//                snapshot.
+//   Macros       each macro's value and one 8 byte record per destination
+//                (cc, channel, flags, curve, range).
+//   Settings     destination merge policy, refresh settings (resend on
+//                transport start, keep-alive interval) and lookahead time.
+//   Slot extras  each slot's MIDI modulation source and grid quantize setting.
+// Its exact size is known up front, so writing it is a single
+// allocation and a straight copy.
+//
+// The XML form is what SimpleCC 1.0 wrote; it is still read so that older
+// sessions load, and written only for comparison benchmarks. It carries only
+// the slots and the preset, so everything else reads back as its default.
+
+namespace StateChunk
+{
+    constexpr juce::uint16 binaryVersion = 1;
+    constexpr int headerSize = 16;
+    constexpr int slotRecordSize = 8;
+    constexpr int macroDestinationRecordSize = 8;
+
+    struct Slot
+    {
+        int ccNumber = -1;
+        int midiChannel = 1;
+        bool enabled = false;
+        int messageType = 0;
+        float value = 0.0f;
+        juce::String name;
+    };
+
+    struct Program
+    {
+        int index = 0;
+        juce::String name;
+        std::vector<Slot> slots;
+    };
+
+    struct MacroDestination
+    {
+        int ccNumber = -1;
+        int midiChannel = 1;
+        bool enabled = false;
+        int curve = 0;
+        int minValue = 0;
+        int maxValue = 127;
+    };
+
+    struct Macro
+    {
+        float value = 0.0f;
+        std::vector<MacroDestination> destinations;
+    };
+
+    struct SlotSource
+    {
+        int type = 0;
+        int ccNumber = 0;
+    };
+
+    struct State
+    {
+        std::vector<Slot> slots;
+        juce::String presetManufacturer;
+        juce::String presetName;
+        bool presetIsUser = false;
+        juce::String userPreset;
+
+        int currentProgram = 0;
+        int programChangeChannel = -1;
+        std::vector<Program> programs;
+
+        int morphMode = 0;
+        float morphX = 0.0f;
+        float morphY = 0.0f;
+        std::vector<std::vector<float>> snapshots;
+
+        std::vector<Macro> macros;
+        int mergePolicy = 0;
+
+        bool refreshOnTransportStart = false;
+        int keepAliveSeconds = 0;
+        int lookaheadMs = 0;
+
+        std::vector<SlotSource> slotSources;
+        std::vector<int> slotGridDivisions;
+    };
+
+    size_t getBinarySize(const State& state);
+    void writeBinary(const State& state, juce::MemoryBlock& destData);
+    bool isBinary(const void* data, int sizeInBytes);
+    bool readBinary(const void* data, int sizeInBytes, State& state);
+
+    std::unique_ptr<juce::XmlElement> createXml(const State& state);
+    bool readXml(const juce::XmlElement& xml, State& state);
+}
@@ -0,0 +1,103 @@
+#include "SysExDump.h"
+
+bool SysExDump::render(const SysExTemplate& sysexTemplate, int numSlots)
+{
+    clear();
+
+    const auto& source = sysexTemplate.bytes;
+    int size = (int)source.size();
+
+    if (size < 3 || source.front() != 0xf0 || source.back() != 0xf7)
+        return false;
+
+    // Only the first and last bytes may have the top bit set.
+    for (int i = 1; i < size - 1; ++i)
+        if ((source[(size_t)i] & 0x80) != 0)
+            return false;
+
+    auto isPayloadByte = [size](int offset) { return offset > 0 && offset < size - 1; };
+
+    if (sysexTemplate.checksum != checksumNone)
+    {
+        if (!isPayloadByte(sysexTemplate.checksumOffset)
+            || sysexTemplate.checksumStart < 1 || sysexTemplate.checksumEnd > size - 1
+            || sysexTemplate.checksumStart >= sysexTemplate.checksumEnd
+            || (sysexTemplate.checksumOffset >= sysexTemplate.checksumStart && sysexTemplate.checksumOffset < sysexTemplate.checksumEnd))
+            return false;
+    }
+
+    int numValues = juce::jmin(numSlots, (int)sysexTemplate.slotValues.size(), 32);
+    slotValues.assign((size_t)numSlots, {});
+
+    for (int i = 0; i < numValues; ++i)
+    {
+        const auto& value = sysexTemplate.slotValues[(size_t)i];
+
+        if (value.offset < 0)
+            continue;
+
+        if (!isPayloadByte(value.offset) || value.offset == sysexTemplate.checksumOffset
+            || value.messageType < 0 || value.messageType >= SlotMessage::numTypes
+            || value.channel < 1 || value.channel > 16 || value.number < 0 || value.number > 127
+            || value.minValue < 0 || value.maxValue > 127 || value.minValue > value.maxValue)
+        {
+            clear();
+            return false;
+        }
+
+        auto& slot = slotValues[(size_t)i];
+        slot.offset = value.offset;
+        slot.destinationKey = SlotMessage::getDestinationKey(value.messageType, value.channel, value.number);
+        slot.minValue = value.minValue;
+        slot.maxValue = value.maxValue;
+        slot.defaultValue = source[(size_t)value.offset];
+        slotMask |= 1u << i;
+    }
+
+    bytes = source;
+    checksum = sysexTemplate.checksum;
+    checksumStart = sysexTemplate.checksumStart;
+    checksumEnd = sysexTemplate.checksumEnd;
+    checksumOffset = sysexTemplate.checksumOffset;
+    updateChecksum();
+    return true;
+}
+
+void SysExDump::clear()
+{
+    bytes.clear();
+    slotValues.clear();
+    slotMask = 0;
+    checksum = checksumNone;
+    checksumOffset = -1;
+}
+
+void SysExDump::setSlotValue(int slot, float normalizedValue)
+{
+    if (((slotMask >> slot) & 1) == 0)
+        return;
+
+    const auto& value = slotValues[(size_t)slot];
+    int range = value.maxValue - value.minValue;
+    bytes[(size_t)value.offset] = (juce::uint8)(value.minValue + juce::jlimit(0, range, juce::roundToInt(normalizedValue * (float)range)));
+}
+
+void SysExDump::resetSlotValue(int slot)
+{
+    if (((slotMask >> slot) & 1) != 0)
+        bytes[(size_t)slotValues[(size_t)slot].offset] = slotValues[(size_t)slot].defaultValue;
+}
+
+void SysExDump::updateChecksum()
+{
+    if (checksum == checksumNone)
+        return;
+
+    int sum = 0;
+
+    for (int i = checksumStart; i < checksumEnd; ++i)
+        sum += bytes[(size_t)i];
+
+    bytes[(size_t)checksumOffset] = (juce::uint8)(checksum == checksumTwosComplement ? (128 - sum % 128) % 128
+                                                                                     : sum & 0x7f);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "InstrumentPresets.h"
+#include <vector>
+
+// An instrument preset's SysEx template rendered into a buffer that the audio
+// thread patches in place.
+//
+// render() validates the template and does all the allocation on the message
+// thread. setSlotValue() and updateChecksum() only overwrite bytes that
+// already exist, so sending a dump is a handful of stores and one addEvent.
+
+class SysExDump
+{
+public:
+    // Returns false, leaving the dump empty, if the template is malformed.
+    bool render(const SysExTemplate& sysexTemplate, int numSlots);
+    void clear();
+
+    bool isEmpty() const { return bytes.empty(); }
+    int getSize() const { return (int)bytes.size(); }
+    const juce::uint8* getData() const { return bytes.data(); }
+
+    // Bit i is set when the template has a byte for slot i's value.
+    juce::uint32 getSlotMask() const { return slotMask; }
+
+    // The destination key slot i must send to for the dump to carry it.
+    int getSlotDestinationKey(int slot) const { return slotValues[(size_t)slot].destinationKey; }
+
+    // Scales a normalized value into the byte's range.
+    void setSlotValue(int slot, float normalizedValue);
+    // Puts the template's default back, for a slot that no longer sends to
+    // the byte's destination.
+    void resetSlotValue(int slot);
+    void updateChecksum();
+
+private:
+    struct SlotValue
+    {
+        int offset = -1;
+        int destinationKey = -1;
+        int minValue = 0;
+        int maxValue = 127;
+        juce::uint8 defaultValue = 0;
+    };
+
+    std::vector<juce::uint8> bytes;
+    std::vector<SlotValue> slotValues;
+    juce::uint32 slotMask = 0;
+    int checksum = checksumNone;
+    int checksumStart = 0;
+    int checksumEnd = 0;
+    int checksumOffset = -1;
+};
@@ -0,0 +1,152 @@
+#include "Tracing.h"
+
+#include <atomic>
+
+namespace
+{
+    constexpr int maxThreads = 32;
+    constexpr int eventsPerThread = 8192;
+
+    // Fields are atomics so the exporter can read a slot while its thread
+    // overwrites it; a torn copy is detected and skipped, never undefined.
+    struct Event
+    {
+        std::atomic<const char*> name { nullptr };
+        std::atomic<juce::int64> startTicks { 0 };
+        std::atomic<juce::int64> endTicks { 0 };
+    };
+
+    // numWritten is the write index: the owner fills the next slot, then
+    // publishes it with a release store that the exporter acquires. A buffer
+    // goes back to the pool when its thread exits, keeping its events until
+    // another thread claims it and carries on from the same index.
+    struct ThreadBuffer
+    {
+        Event events[eventsPerThread];
+        std::atomic<juce::uint64> numWritten { 0 };
+        std::atomic<bool> inUse { false };
+        std::atomic<bool> everUsed { false };
+        std::atomic<bool> isMessageThread { false };
+    };
+
+    ThreadBuffer buffers[maxThreads];
+
+    struct ThreadBufferClaim
+    {
+        ThreadBuffer* buffer = nullptr;
+        bool outOfBuffers = false;
+
+        ~ThreadBufferClaim()
+        {
+            if (buffer != nullptr)
+                buffer->inUse.store(false, std::memory_order_release);
+        }
+    };
+
+    // Registering this destructor at a thread's first event is the only
+    // allocation tracing makes on that thread.
+    thread_local ThreadBufferClaim threadClaim;
+
+    ThreadBuffer* getThreadBuffer() noexcept
+    {
+        auto& claim = threadClaim;
+
+        if (claim.buffer == nullptr && !claim.outOfBuffers)
+        {
+            for (auto& buffer : buffers)
+            {
+                bool expected = false;
+
+                if (buffer.inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                {
+                    buffer.isMessageThread.store(juce::MessageManager::existsAndIsCurrentThread(), std::memory_order_relaxed);
+                    buffer.everUsed.store(true, std::memory_order_release);
+                    claim.buffer = &buffer;
+                    break;
+                }
+            }
+
+            claim.outOfBuffers = claim.buffer == nullptr;
+        }
+
+        return claim.buffer;
+    }
+
+    double ticksToMicroseconds(juce::int64 ticks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+    }
+}
+
+namespace Tracing
+{
+    Scope::Scope(const char* scopeName) noexcept
+        : name(scopeName), startTicks(juce::Time::getHighResolutionTicks())
+    {
+    }
+
+    Scope::~Scope()
+    {
+        auto endTicks = juce::Time::getHighResolutionTicks();
+
+        if (auto* buffer = getThreadBuffer())
+        {
+            auto index = buffer->numWritten.load(std::memory_order_relaxed);
+            auto& event = buffer->events[index % eventsPerThread];
+            event.name.store(name, std::memory_order_relaxed);
+            event.startTicks.store(startTicks, std::memory_order_relaxed);
+            event.endTicks.store(endTicks, std::memory_order_relaxed);
+            buffer->numWritten.store(index + 1, std::memory_order_release);
+        }
+    }
+
+    bool writeChromeTrace(const juce::File& file)
+    {
+        juce::String json;
+        json << "{\"traceEvents\":[\n";
+        bool first = true;
+
+        auto append = [&](const juce::String& event) {
+            json << (first ? "" : ",\n") << event;
+            first = false;
+        };
+
+        for (int t = 0; t < maxThreads; ++t)
+        {
+            auto& buffer = buffers[t];
+
+            if (!buffer.everUsed.load(std::memory_order_acquire))
+                continue;
+
+            juce::String threadName = buffer.isMessageThread.load(std::memory_order_relaxed) ? "Message thread" : "Thread " + juce::String(t);
+
+            append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + juce::String(t)
+                   + ",\"args\":{\"name\":\"" + threadName + "\"}}");
+
+            auto end = buffer.numWritten.load(std::memory_order_acquire);
+            auto count = juce::jmin(end, (juce::uint64)eventsPerThread);
+
+            for (auto i = end - count; i < end; ++i)
+            {
+                const auto& slot = buffer.events[i % eventsPerThread];
+                auto name = slot.name.load(std::memory_order_relaxed);
+                auto startTicks = slot.startTicks.load(std::memory_order_relaxed);
+                auto endTicks = slot.endTicks.load(std::memory_order_relaxed);
+
+                // If the owner has since come round to this slot again, the
+                // copy may mix two events.
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (buffer.numWritten.load(std::memory_order_relaxed) - i > (juce::uint64)eventsPerThread - 1)
+                    continue;
+
+                append("{\"name\":\"" + juce::String(name) + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + juce::String(t)
+                       + ",\"ts\":" + juce::String(ticksToMicroseconds(startTicks), 3)
+                       + ",\"dur\":" + juce::String(ticksToMicroseconds(endTicks - startTicks), 3) + "}");
+            }
+        }
+
+        json << "\n]}\n";
+        return file.replaceWithText(json);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Optional scoped tracing, compiled in with SIMPLECC_TRACING.
+//
+// SIMPLECC_TRACE_SCOPE("name") records the start and end of the enclosing
+// scope into a buffer owned by the calling thread. Buffers come from a pool
+// allocated statically: the first event on a thread (including the host's
+// audio thread) claims a free one without locking, and the buffer returns
+// to the pool when the thread exits, so hosts that recycle worker threads
+// don't run the pool dry. Each buffer keeps its most recent events and
+// overwrites the oldest. writeChromeTrace() dumps every buffer as Chrome
+// trace event JSON, which chrome://tracing and Perfetto both open.
+//
+// Names must be string literals; only the pointer is stored. With tracing
+// off the macro expands to nothing.
+
+namespace Tracing
+{
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name) noexcept;
+        ~Scope();
+
+    private:
+        const char* name;
+        juce::int64 startTicks;
+    };
+
+    bool writeChromeTrace(const juce::File& file);
+}
+
+#if SIMPLECC_TRACING
+ #define SIMPLECC_TRACE_CONCAT_INNER(a, b) a##b
+ #define SIMPLECC_TRACE_CONCAT(a, b) SIMPLECC_TRACE_CONCAT_INNER(a, b)
+ #define SIMPLECC_TRACE_SCOPE(name) const Tracing::Scope SIMPLECC_TRACE_CONCAT(simplecc_traceScope, __LINE__)(name)
+#else
+ #define SIMPLECC_TRACE_SCOPE(name)
+#endif
@@ -0,0 +1,28 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#include <iostream>
+
+// Runs every SimpleCC unit test linked into the binary and exits non-zero
+// if any of them failed, so ctest can gate on it.
+
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    // Never read the user's presets.
+    SimpleCCProcessor::setPresetDirectoryOverride(juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                                      .getChildFile("SimpleCCTestsNoPresets"));
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runTestsInCategory("SimpleCC");
+
+    int failures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        failures += runner.getResult(i)->failures;
+
+    std::cout << (failures == 0 ? "PASS" : "FAIL") << ", " << failures << " failure(s)\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+#include <JuceHeader.h>
+#include "MidiDelayLine.h"
+
+namespace
+{
+    struct Popped
+    {
+        int samplePosition;
+        std::vector<juce::uint8> bytes;
+
+        bool operator== (const Popped& other) const { return samplePosition == other.samplePosition && bytes == other.bytes; }
+    };
+
+    std::vector<Popped> collect(const juce::MidiBuffer& buffer)
+    {
+        std::vector<Popped> events;
+
+        for (const auto metadata : buffer)
+            events.push_back({ metadata.samplePosition, std::vector<juce::uint8>(metadata.data, metadata.data + metadata.numBytes) });
+
+        return events;
+    }
+
+    bool pushController(MidiDelayLine& line, juce::int64 dueTime, int number)
+    {
+        const juce::uint8 bytes[] = { 0xb0, (juce::uint8)number, 0x40 };
+        return line.push(dueTime, bytes, 3);
+    }
+
+    Popped controller(int samplePosition, int number)
+    {
+        return { samplePosition, { 0xb0, (juce::uint8)number, 0x40 } };
+    }
+
+    // A controller takes the 10 byte header plus its 3 bytes.
+    constexpr size_t controllerRecordSize = 13;
+}
+
+class MidiDelayLineTests : public juce::UnitTest
+{
+public:
+    MidiDelayLineTests() : juce::UnitTest("MIDI delay line", "SimpleCC") {}
+
+    void runTest() override
+    {
+        beginTest("Records split across the end of storage come back whole");
+        {
+            // Each pass moves 29 bytes through 32 bytes of storage, so records
+            // start at every offset in turn and the split falls in the due
+            // time, the size and the data.
+            MidiDelayLine line;
+            line.prepare(32);
+
+            for (int i = 0; i < 32; ++i)
+            {
+                const juce::uint8 sysex[] = { 0xf0, 0x41, (juce::uint8)i, 0x12, 0x00, 0xf7 };
+                juce::int64 dueTime = 0x0102030405060708 + i;
+
+                expect(line.push(dueTime, sysex, 6), "push at record " + juce::String(i));
+                expect(pushController(line, dueTime, i), "controller at record " + juce::String(i));
+
+                juce::MidiBuffer midi;
+                line.popDue(dueTime - 7, dueTime + 1, midi);
+
+                auto events = collect(midi);
+                expect(events == std::vector<Popped> { { 7, { 0xf0, 0x41, (juce::uint8)i, 0x12, 0x00, 0xf7 } }, controller(7, i) },
+                       "record " + juce::String(i));
+                expect(line.isEmpty());
+            }
+        }
+
+        beginTest("Events come out in order at their position in each block");
+        {
+            MidiDelayLine line;
+            line.prepare(1024);
+
+            for (auto [time, number] : { std::pair<juce::int64, int> { 100, 1 }, { 600, 2 }, { 1000, 3 }, { 1023, 4 },
+                                         { 1023, 5 }, { 1024, 6 }, { 2000, 7 } })
+                expect(pushController(line, time, number));
+
+            std::vector<std::vector<Popped>> blocks;
+
+            for (juce::int64 start = 0; start < 2048; start += 512)
+            {
+                juce::MidiBuffer midi;
+                line.popDue(start, start + 512, midi);
+                blocks.push_back(collect(midi));
+            }
+
+            expect(blocks[0] == std::vector<Popped> { controller(100, 1) });
+            expect(blocks[1] == std::vector<Popped> { controller(88, 2), controller(488, 3), controller(511, 4), controller(511, 5) });
+            expect(blocks[2] == std::vector<Popped> { controller(0, 6) });
+            expect(blocks[3] == std::vector<Popped> { controller(464, 7) });
+            expect(line.isEmpty());
+        }
+
+        beginTest("Late events land at the start of the block");
+        {
+            MidiDelayLine line;
+            line.prepare(1024);
+            expect(pushController(line, 50, 1));
+            expect(pushController(line, 530, 2));
+
+            juce::MidiBuffer midi;
+            line.popDue(512, 1024, midi);
+            expect(collect(midi) == std::vector<Popped> { controller(0, 1), controller(18, 2) });
+        }
+
+        beginTest("A full line refuses events until there is room");
+        {
+            MidiDelayLine line;
+            line.prepare(2 * controllerRecordSize);
+
+            expect(pushController(line, 10, 1));
+            expect(pushController(line, 20, 2));
+            expect(!pushController(line, 30, 3), "no room for a third record");
+
+            const juce::uint8 empty[] = { 0 };
+            expect(!line.push(5, empty, 0), "an empty event is refused");
+
+            juce::MidiBuffer midi;
+            line.popDue(0, 15, midi);
+            expect(collect(midi) == std::vector<Popped> { controller(10, 1) });
+
+            expect(pushController(line, 30, 3), "room again once one is popped");
+
+            midi.clear();
+            line.popDue(0, 64, midi);
+            expect(collect(midi) == std::vector<Popped> { controller(20, 2), controller(30, 3) });
+        }
+
+        beginTest("Flush moves everything oldest first to one position");
+        {
+            MidiDelayLine line;
+            line.prepare(1024);
+
+            for (auto [time, number] : { std::pair<juce::int64, int> { 100, 1 }, { 5000, 2 }, { 100000, 3 } })
+                expect(pushController(line, time, number));
+
+            juce::MidiBuffer midi;
+            line.popDue(0, 512, midi);
+            expect(collect(midi) == std::vector<Popped> { controller(100, 1) });
+
+            midi.clear();
+            line.flush(midi, 42);
+            expect(collect(midi) == std::vector<Popped> { controller(42, 2), controller(42, 3) });
+            expect(line.isEmpty());
+
+            midi.clear();
+            line.popDue(0, 1 << 20, midi);
+            expect(midi.isEmpty());
+        }
+    }
+};
+
+static MidiDelayLineTests midiDelayLineTests;
@@ -0,0 +1,104 @@
+#include <JuceHeader.h>
+#include "PresetBank.h"
+#include "SlotMessage.h"
+
+namespace
+{
+    constexpr int numSlots = 8;
+
+    // One slot of every message type, the rest left at their defaults.
+    PresetBankPreset makeTypedPreset()
+    {
+        PresetBankPreset preset;
+        preset.manufacturer = "Test";
+        preset.name = "Every type";
+        preset.slots.resize(numSlots);
+
+        for (int type = 0; type < SlotMessage::numTypes; ++type)
+        {
+            auto& slot = preset.slots[(size_t)type];
+            slot.ccNumber = 20 + type;
+            slot.midiChannel = 1 + type;
+            slot.enabled = true;
+            slot.messageType = type;
+            slot.value = 0.25f * (float)(type % 4);
+            slot.name = SlotMessage::encodings[type].name;
+        }
+
+        return preset;
+    }
+}
+
+class PresetBankTests : public juce::UnitTest
+{
+public:
+    PresetBankTests() : juce::UnitTest("Preset bank", "SimpleCC") {}
+
+    void runTest() override
+    {
+        auto preset = makeTypedPreset();
+
+        beginTest("XML keeps each slot's message type");
+        {
+            auto xml = PresetBank::createPresetXml(preset);
+            PresetBankPreset parsed;
+
+            expect(PresetBank::parsePresetXml(*xml, numSlots, parsed));
+            expectSlotsMatch(parsed, preset);
+        }
+
+        beginTest("Bank file keeps each slot's message type");
+        {
+            juce::TemporaryFile temp(juce::String(PresetBank::fileExtension));
+            PresetBankBuilder builder(numSlots);
+            builder.addPreset(preset);
+            expect(builder.writeToFile(temp.getFile()));
+
+            PresetBank bank(temp.getFile());
+            expect(bank.isValid());
+            expectEquals(bank.getNumPresets(), 1);
+            expectSlotsMatch(bank.getPreset(0), preset);
+
+            auto xml = bank.createPresetXml(0);
+            PresetBankPreset parsed;
+            expect(PresetBank::parsePresetXml(*xml, numSlots, parsed));
+            expectSlotsMatch(parsed, preset);
+        }
+
+        beginTest("XML without a type reads as control change");
+        {
+            juce::XmlElement xml("UserPreset");
+            auto* slotXml = xml.createNewChildElement("Slot");
+            slotXml->setAttribute("index", 0);
+            slotXml->setAttribute("cc", 74);
+
+            PresetBankPreset parsed;
+            expect(PresetBank::parsePresetXml(xml, numSlots, parsed));
+            expectEquals(parsed.slots[0].messageType, (int)SlotMessage::controlChange);
+        }
+    }
+
+private:
+    void expectSlotsMatch(const PresetBankPreset& actual, const PresetBankPreset& expected)
+    {
+        expectEquals(actual.manufacturer, expected.manufacturer);
+        expectEquals(actual.name, expected.name);
+        expectEquals((int)actual.slots.size(), (int)expected.slots.size());
+
+        for (size_t i = 0; i < juce::jmin(actual.slots.size(), expected.slots.size()); ++i)
+        {
+            const auto& a = actual.slots[i];
+            const auto& e = expected.slots[i];
+            auto where = "slot " + juce::String((int)i + 1);
+
+            expectEquals(a.messageType, e.messageType, where);
+            expectEquals(a.ccNumber, e.ccNumber, where);
+            expectEquals(a.midiChannel, e.midiChannel, where);
+            expectEquals(a.enabled, e.enabled, where);
+            expectEquals(a.value, e.value, where);
+            expectEquals(a.name, e.name, where);
+        }
+    }
+};
+
+static PresetBankTests presetBankTests;
@@ -0,0 +1,272 @@
+#include "RealtimeCheck.h"
+
+#include <cstdlib>
+#include <new>
+
+// Replacement allocator and mutex entry points for the real-time check
+// harness. Every hook forwards to the real implementation and, when called
+// from inside SIMPLECC_REALTIME_SCOPE, records the call site first.
+//
+// operator new and delete are replaced portably. malloc, calloc, realloc,
+// free and pthread_mutex_lock are interposed on glibc only, where the
+// executable's definitions take precedence over libc's. The originals are
+// looked up once with dlsym(RTLD_NEXT); dlsym can itself allocate, so while
+// a lookup is in flight allocations are served from a small static arena.
+
+#if defined(_MSC_VER)
+ #include <intrin.h>
+ #define SIMPLECC_CALLER _ReturnAddress()
+#else
+ #define SIMPLECC_CALLER __builtin_return_address(0)
+#endif
+
+#define SIMPLECC_RECORD(kind) \
+    if (RealtimeCheck::isInsideRealtimeScope()) \
+        RealtimeCheck::recordViolation(RealtimeCheck::kind, SIMPLECC_CALLER)
+
+#if defined(__linux__) && defined(__GLIBC__)
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <dlfcn.h>
+#include <pthread.h>
+
+namespace
+{
+    using MallocFunction = void* (*)(size_t);
+    using CallocFunction = void* (*)(size_t, size_t);
+    using ReallocFunction = void* (*)(void*, size_t);
+    using FreeFunction = void (*)(void*);
+    using MutexLockFunction = int (*)(pthread_mutex_t*);
+
+    struct NextFunctions
+    {
+        MallocFunction malloc = nullptr;
+        CallocFunction calloc = nullptr;
+        ReallocFunction realloc = nullptr;
+        FreeFunction free = nullptr;
+        MutexLockFunction mutexLock = nullptr;
+    };
+
+    NextFunctions next;
+    std::atomic<bool> resolved { false };
+    thread_local bool resolving = false;
+
+    // Allocations made by dlsym while it resolves the functions above. They
+    // are never freed; a few hundred bytes are needed in practice.
+    alignas(std::max_align_t) unsigned char bootstrapArena[8192];
+    std::atomic<size_t> bootstrapUsed { 0 };
+
+    bool isBootstrapPointer(const void* pointer) noexcept
+    {
+        const auto* bytes = static_cast<const unsigned char*>(pointer);
+        return bytes >= bootstrapArena && bytes < bootstrapArena + sizeof(bootstrapArena);
+    }
+
+    void* bootstrapAllocate(size_t size) noexcept
+    {
+        const auto alignment = alignof(std::max_align_t);
+        const auto rounded = (size + alignment - 1) / alignment * alignment;
+        const auto offset = bootstrapUsed.fetch_add(rounded);
+
+        if (offset + rounded > sizeof(bootstrapArena))
+            return nullptr;
+
+        return bootstrapArena + offset;
+    }
+
+    template <typename Function>
+    Function lookUpNext(const char* name) noexcept
+    {
+        return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+    }
+
+    // Returns false while this thread is inside dlsym, in which case the
+    // caller must not touch next.
+    bool resolveNextFunctions() noexcept
+    {
+        if (resolved.load(std::memory_order_acquire))
+            return true;
+
+        if (resolving)
+            return false;
+
+        resolving = true;
+
+        NextFunctions found;
+        found.malloc = lookUpNext<MallocFunction>("malloc");
+        found.calloc = lookUpNext<CallocFunction>("calloc");
+        found.realloc = lookUpNext<ReallocFunction>("realloc");
+        found.free = lookUpNext<FreeFunction>("free");
+        found.mutexLock = lookUpNext<MutexLockFunction>("pthread_mutex_lock");
+
+        // Threads racing here all find the same addresses, so the copy is
+        // benign; the release store publishes it.
+        next = found;
+        resolved.store(true, std::memory_order_release);
+
+        resolving = false;
+        return true;
+    }
+
+    void* rawAllocate(size_t size) noexcept
+    {
+        if (! resolveNextFunctions())
+            return bootstrapAllocate(size);
+
+        return next.malloc(size);
+    }
+
+    void rawFree(void* pointer) noexcept
+    {
+        if (pointer == nullptr || isBootstrapPointer(pointer))
+            return;
+
+        if (resolveNextFunctions())
+            next.free(pointer);
+    }
+}
+
+extern "C"
+{
+    void* malloc(size_t size)
+    {
+        SIMPLECC_RECORD(kindMalloc);
+        return rawAllocate(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        SIMPLECC_RECORD(kindCalloc);
+
+        if (! resolveNextFunctions())
+        {
+            // The arena is zero-initialised and never reused.
+            if (size != 0 && count > static_cast<size_t>(-1) / size)
+                return nullptr;
+
+            return bootstrapAllocate(count * size);
+        }
+
+        return next.calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size)
+    {
+        SIMPLECC_RECORD(kindRealloc);
+
+        if (pointer != nullptr && isBootstrapPointer(pointer))
+        {
+            // Bootstrap blocks don't record their size; copy what can
+            // still lie inside the arena.
+            auto* moved = rawAllocate(size);
+
+            if (moved != nullptr)
+            {
+                const auto available = static_cast<size_t>(bootstrapArena + sizeof(bootstrapArena)
+                                                           - static_cast<unsigned char*>(pointer));
+                std::memcpy(moved, pointer, size < available ? size : available);
+            }
+
+            return moved;
+        }
+
+        if (! resolveNextFunctions())
+            return pointer == nullptr ? bootstrapAllocate(size) : nullptr;
+
+        return next.realloc(pointer, size);
+    }
+
+    void free(void* pointer)
+    {
+        if (pointer != nullptr)
+            SIMPLECC_RECORD(kindFree);
+
+        rawFree(pointer);
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        SIMPLECC_RECORD(kindMutexLock);
+
+        if (! resolveNextFunctions())
+            return 0; // only reachable from dlsym on this thread, which already holds the loader lock
+
+        return next.mutexLock(mutex);
+    }
+}
+
+ #define SIMPLECC_RAW_ALLOC(size) rawAllocate(size)
+ #define SIMPLECC_RAW_FREE(pointer) rawFree(pointer)
+#else
+ #define SIMPLECC_RAW_ALLOC(size) std::malloc(size)
+ #define SIMPLECC_RAW_FREE(pointer) std::free(pointer)
+#endif
+
+namespace
+{
+    void* allocate(std::size_t size)
+    {
+        if (auto* pointer = SIMPLECC_RAW_ALLOC(size == 0 ? 1 : size))
+            return pointer;
+
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    SIMPLECC_RECORD(kindOperatorNew);
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    SIMPLECC_RECORD(kindOperatorNew);
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    SIMPLECC_RECORD(kindOperatorNew);
+    return SIMPLECC_RAW_ALLOC(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    SIMPLECC_RECORD(kindOperatorNew);
+    return SIMPLECC_RAW_ALLOC(size == 0 ? 1 : size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        SIMPLECC_RECORD(kindOperatorDelete);
+
+    SIMPLECC_RAW_FREE(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        SIMPLECC_RECORD(kindOperatorDelete);
+
+    SIMPLECC_RAW_FREE(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    if (pointer != nullptr)
+        SIMPLECC_RECORD(kindOperatorDelete);
+
+    SIMPLECC_RAW_FREE(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    if (pointer != nullptr)
+        SIMPLECC_RECORD(kindOperatorDelete);
+
+    SIMPLECC_RAW_FREE(pointer);
+}
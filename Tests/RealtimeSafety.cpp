@@ -0,0 +1,174 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "RealtimeCheck.h"
+
+#include <iostream>
+
+#if ! defined(_WIN32)
+ #include <cxxabi.h>
+ #include <dlfcn.h>
+#endif
+
+// Drives SimpleCCProcessor::processBlock through the configurations that
+// exercise each of its paths and reports every allocation, deallocation and
+// mutex lock that happened inside it, grouped by call site. Exits non-zero
+// if there were any, so it can gate a release from ctest.
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 256;
+    constexpr int blocksPerScenario = 200;
+
+    juce::String describeCallSite(const void* address)
+    {
+       #if ! defined(_WIN32)
+        Dl_info info;
+
+        if (dladdr(address, &info) != 0 && info.dli_sname != nullptr)
+        {
+            int status = 0;
+            auto* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            juce::String name = status == 0 ? demangled : info.dli_sname;
+            std::free(demangled);
+
+            auto offset = (juce::int64)((const char*)address - (const char*)info.dli_saddr);
+            return name + " + 0x" + juce::String::toHexString(offset);
+        }
+       #endif
+
+        return "0x" + juce::String::toHexString((juce::pointer_sized_int)address);
+    }
+
+    void fillIncomingMidi(juce::MidiBuffer& midi, int block)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            int position = i * blockSize / 8;
+            midi.addEvent(juce::MidiMessage::noteOn(1, 36 + (block + i) % 48, (juce::uint8)(64 + i)), position);
+            midi.addEvent(juce::MidiMessage::controllerEvent(1, 20 + i, (block * 7 + i) % 128), position);
+            midi.addEvent(juce::MidiMessage::channelPressureChange(1, (block + i) % 128), position);
+            midi.addEvent(juce::MidiMessage::noteOff(1, 36 + (block + i) % 48), position + 1);
+        }
+
+        if (block % 50 == 0)
+            midi.addEvent(juce::MidiMessage::programChange(1, (block / 50) % 4), 0);
+    }
+
+    struct Scenario
+    {
+        const char* name;
+        std::function<void(SimpleCCProcessor&)> setUp;
+        bool incomingMidi;
+    };
+
+    bool runScenario(const Scenario& scenario)
+    {
+        SimpleCCProcessor processor;
+        processor.setPlayConfigDetails(0, 0, sampleRate, blockSize);
+
+        for (int i = 0; i < NUM_SLOTS; ++i)
+        {
+            processor.setSlotEnabled(i, true);
+            processor.setSlotCCNumber(i, 20 + i);
+        }
+
+        scenario.setUp(processor);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer(1, blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(64 * 1024);
+
+        RealtimeCheck::reset();
+
+        for (int block = 0; block < blocksPerScenario; ++block)
+        {
+            midi.clear();
+
+            if (scenario.incomingMidi)
+                fillIncomingMidi(midi, block);
+
+            for (int i = 0; i < NUM_SLOTS; ++i)
+                processor.getSlotParameter(i)->setValueNotifyingHost((float)((block + i) % 100) / 99.0f);
+
+            processor.processBlock(buffer, midi);
+        }
+
+        processor.releaseResources();
+
+        auto violations = RealtimeCheck::getViolations();
+        auto dropped = RealtimeCheck::getNumDroppedViolations();
+
+        std::cout << (violations.empty() && dropped == 0 ? "PASS " : "FAIL ") << scenario.name << "\n";
+
+        for (const auto& violation : violations)
+            std::cout << "    " << violation.count << " x " << RealtimeCheck::getKindName(violation.kind)
+                      << " from " << describeCallSite(violation.callSite) << "\n";
+
+        if (dropped > 0)
+            std::cout << "    " << dropped << " more from call sites that did not fit in the table\n";
+
+        return violations.empty() && dropped == 0;
+    }
+}
+
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const Scenario scenarios[] = {
+        { "parameters", [](SimpleCCProcessor&) {}, false },
+        { "pass-through", [](SimpleCCProcessor&) {}, true },
+        { "midi sources", [](SimpleCCProcessor& p) {
+              p.setSlotSource(0, { sourceVelocity, 0 });
+              p.setSlotSource(1, { sourceNoteNumber, 0 });
+              p.setSlotSource(2, { sourceChannelPressure, 0 });
+              p.setSlotSource(3, { sourceController, 21 });
+          }, true },
+        { "message types", [](SimpleCCProcessor& p) {
+              for (int i = 0; i < NUM_SLOTS; ++i)
+              {
+                  p.setSlotMessageType(i, i % SlotMessage::numTypes);
+                  p.setSlotMidiChannel(i, 1 + i);
+              }
+          }, false },
+        { "merge", [](SimpleCCProcessor& p) {
+              for (int i = 0; i < NUM_SLOTS; ++i)
+                  p.setSlotCCNumber(i, 20 + i % 4);
+              p.setDestinationMergePolicy(mergeAverage);
+          }, false },
+        { "morph", [](SimpleCCProcessor& p) {
+              p.captureSnapshot(0);
+              p.getMorphModeParameter()->setValueNotifyingHost(1.0f);
+          }, false },
+        { "macros", [](SimpleCCProcessor& p) {
+              for (int m = 0; m < NUM_MACROS; ++m)
+              {
+                  for (int d = 0; d < MACRO_DESTINATIONS; ++d)
+                  {
+                      MacroDestination destination;
+                      destination.ccNumber = 40 + m * MACRO_DESTINATIONS + d;
+                      destination.enabled = true;
+                      destination.curve = d % 3;
+                      p.setMacroDestination(m, d, destination);
+                  }
+
+                  p.getMacroParameter(m)->setValueNotifyingHost(0.5f);
+              }
+          }, false },
+        { "lookahead", [](SimpleCCProcessor& p) { p.setLookaheadMs(5); }, true },
+        { "program change", [](SimpleCCProcessor& p) { p.setProgramChangeChannel(0); }, true },
+        { "refresh", [](SimpleCCProcessor& p) {
+              p.setKeepAliveSeconds(1);
+              p.requestRefresh();
+          }, false }
+    };
+
+    bool passed = true;
+
+    for (const auto& scenario : scenarios)
+        passed = runScenario(scenario) && passed;
+
+    return passed ? 0 : 1;
+}
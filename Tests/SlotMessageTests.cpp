@@ -0,0 +1,124 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "SlotMessage.h"
+
+#include <set>
+
+namespace
+{
+    std::vector<std::vector<juce::uint8>> processOneBlock(SimpleCCProcessor& processor)
+    {
+        juce::AudioBuffer<float> buffer(0, 512);
+        juce::MidiBuffer midi;
+        processor.processBlock(buffer, midi);
+
+        std::vector<std::vector<juce::uint8>> messages;
+
+        for (const auto metadata : midi)
+            messages.emplace_back(metadata.data, metadata.data + metadata.numBytes);
+
+        return messages;
+    }
+}
+
+class SlotMessageTests : public juce::UnitTest
+{
+public:
+    SlotMessageTests() : juce::UnitTest("Slot messages", "SimpleCC") {}
+
+    void runTest() override
+    {
+        beginTest("A 14-bit controller encodes as MSB then LSB");
+        {
+            juce::uint8 bytes[SlotMessage::maxEncodedSize];
+            int size = SlotMessage::encode(SlotMessage::controlChange14, 3, 7, 0x1234, bytes);
+
+            expectEquals(size, 6);
+            expect(std::vector<juce::uint8>(bytes, bytes + size)
+                   == std::vector<juce::uint8> { 0xb2, 0x07, 0x24, 0xb2, 0x27, 0x34 });
+        }
+
+        beginTest("Destination keys round-trip for every type");
+        {
+            std::set<int> keys;
+
+            for (int type = 0; type < SlotMessage::numTypes; ++type)
+            {
+                for (int channel = 1; channel <= 16; ++channel)
+                {
+                    for (int number = 0; number <= SlotMessage::getMaxNumber(type); ++number)
+                    {
+                        int key = SlotMessage::getDestinationKey(type, channel, number);
+                        expect(key >= 0 && key < SlotMessage::numDestinationKeys);
+
+                        int decodedType, decodedChannel, decodedNumber;
+                        SlotMessage::decodeDestinationKey(key, decodedType, decodedChannel, decodedNumber);
+                        expectEquals(decodedType, type);
+                        expectEquals(decodedChannel, channel);
+                        expectEquals(decodedNumber, SlotMessage::usesNumber(type) ? number : 0);
+
+                        keys.insert(key);
+
+                        if (!SlotMessage::usesNumber(type))
+                            break;
+                    }
+                }
+            }
+
+            expectEquals((int)keys.size(), SlotMessage::numDestinationKeys);
+        }
+
+        beginTest("A 14-bit controller is deduplicated on its 14-bit value");
+        {
+            SimpleCCProcessor processor;
+            processor.setPlayConfigDetails(0, 0, 48000.0, 512);
+
+            {
+                SimpleCCProcessor::ScopedSlotUpdate update(processor);
+
+                for (int i = 0; i < NUM_SLOTS; ++i)
+                    processor.setSlotEnabled(i, i == 0);
+
+                processor.setSlotMessageType(0, SlotMessage::controlChange14);
+                processor.setSlotMidiChannel(0, 1);
+                processor.setSlotCCNumber(0, 1);
+                processor.setSlotValue(0, 8192.0f / 16383.0f);
+            }
+
+            processor.prepareToPlay(48000.0, 512);
+
+            auto first = processOneBlock(processor);
+            expect(first == std::vector<std::vector<juce::uint8>> { { 0xb0, 0x01, 0x40 }, { 0xb0, 0x21, 0x00 } });
+
+            // One step of the LSB is a change; a fraction of one is not.
+            processor.setSlotValue(0, 8193.0f / 16383.0f);
+            auto lsbStep = processOneBlock(processor);
+            expect(lsbStep == std::vector<std::vector<juce::uint8>> { { 0xb0, 0x01, 0x40 }, { 0xb0, 0x21, 0x01 } });
+
+            processor.setSlotValue(0, 8193.2f / 16383.0f);
+            expect(processOneBlock(processor).empty());
+        }
+
+        beginTest("A 14-bit controller above 31 sends nothing");
+        {
+            SimpleCCProcessor processor;
+            processor.setPlayConfigDetails(0, 0, 48000.0, 512);
+
+            {
+                SimpleCCProcessor::ScopedSlotUpdate update(processor);
+
+                for (int i = 0; i < NUM_SLOTS; ++i)
+                    processor.setSlotEnabled(i, i == 0);
+
+                processor.setSlotMessageType(0, SlotMessage::controlChange14);
+                processor.setSlotCCNumber(0, 74);
+                processor.setSlotValue(0, 1.0f);
+            }
+
+            processor.prepareToPlay(48000.0, 512);
+            expect(processOneBlock(processor).empty());
+        }
+    }
+};
+
+static SlotMessageTests slotMessageTests;
@@ -0,0 +1,284 @@
+#include <JuceHeader.h>
+#include "StateChunk.h"
+
+namespace
+{
+    constexpr int numSlots = 8;
+
+    StateChunk::Slot makeSlot(int i)
+    {
+        StateChunk::Slot slot;
+        slot.ccNumber = i == 3 ? -1 : 10 + i;
+        slot.midiChannel = 1 + (i * 5) % 16;
+        slot.enabled = i % 3 != 0;
+        slot.messageType = i % 6;
+        slot.value = (float)i / (float)(numSlots - 1);
+        slot.name = i == 2 ? juce::String::fromUTF8("Cr\xc3\xa8me") : "Slot " + juce::String(i + 1);
+        return slot;
+    }
+
+    // Every section of the chunk holding something other than its default.
+    StateChunk::State makePopulatedState()
+    {
+        StateChunk::State state;
+
+        for (int i = 0; i < numSlots; ++i)
+            state.slots.push_back(makeSlot(i));
+
+        state.presetManufacturer = "Roland";
+        state.presetName = "Sound Canvas";
+        state.presetIsUser = true;
+
+        state.currentProgram = 5;
+        state.programChangeChannel = 10;
+
+        for (int p : { 2, 5 })
+        {
+            StateChunk::Program program;
+            program.index = p;
+            program.name = "Program " + juce::String(p + 1);
+
+            for (int i = 0; i < numSlots; ++i)
+            {
+                auto slot = makeSlot((i + p) % numSlots);
+                slot.value = 1.0f - slot.value;
+                program.slots.push_back(slot);
+            }
+
+            state.programs.push_back(std::move(program));
+        }
+
+        state.morphMode = 2;
+        state.morphX = 0.25f;
+        state.morphY = 0.75f;
+
+        for (int s = 0; s < 4; ++s)
+        {
+            std::vector<float> values;
+
+            for (int i = 0; i < numSlots; ++i)
+                values.push_back((float)((s + i) % 5) / 4.0f);
+
+            state.snapshots.push_back(values);
+        }
+
+        for (int m = 0; m < 2; ++m)
+        {
+            StateChunk::Macro macro;
+            macro.value = 0.5f * (float)m + 0.125f;
+
+            for (int d = 0; d < 3; ++d)
+            {
+                StateChunk::MacroDestination destination;
+                destination.ccNumber = 20 + m * 3 + d;
+                destination.midiChannel = 1 + d;
+                destination.enabled = d != 1;
+                destination.curve = d;
+                destination.minValue = 10 * d;
+                destination.maxValue = 127 - 10 * d;
+                macro.destinations.push_back(destination);
+            }
+
+            state.macros.push_back(std::move(macro));
+        }
+
+        state.mergePolicy = 1;
+        state.refreshOnTransportStart = true;
+        state.keepAliveSeconds = 30;
+        state.lookaheadMs = 12;
+
+        for (int i = 0; i < numSlots; ++i)
+        {
+            state.slotSources.push_back({ i % 3, 64 + i });
+            state.slotGridDivisions.push_back(i % 4);
+        }
+
+        return state;
+    }
+
+    // A state ready to read into, with every field away from what is read.
+    StateChunk::State makeReadTarget()
+    {
+        StateChunk::State state;
+        state.slots.resize(numSlots);
+        state.programs.resize(3);
+        state.snapshots.resize(1);
+        state.macros.resize(1);
+        state.lookaheadMs = 99;
+        return state;
+    }
+}
+
+class StateChunkTests : public juce::UnitTest
+{
+public:
+    StateChunkTests() : juce::UnitTest("State chunk", "SimpleCC") {}
+
+    void runTest() override
+    {
+        auto original = makePopulatedState();
+        juce::MemoryBlock chunk;
+        StateChunk::writeBinary(original, chunk);
+
+        beginTest("Binary chunk is exactly its computed size");
+        {
+            expectEquals((int)chunk.getSize(), (int)StateChunk::getBinarySize(original));
+            expect(StateChunk::isBinary(chunk.getData(), (int)chunk.getSize()));
+        }
+
+        beginTest("A populated state round-trips through the binary chunk");
+        {
+            auto restored = makeReadTarget();
+            expect(StateChunk::readBinary(chunk.getData(), (int)chunk.getSize(), restored));
+            expectStatesMatch(restored, original);
+        }
+
+        beginTest("Every truncated prefix is rejected");
+        {
+            auto* bytes = static_cast<const juce::uint8*>(chunk.getData());
+
+            for (size_t size = 0; size < chunk.getSize(); ++size)
+            {
+                // As handed over, and with the header claiming the shorter
+                // size so that each section's own bounds check is reached.
+                std::vector<juce::uint8> prefix(bytes, bytes + size);
+                auto target = makeReadTarget();
+                expect(!StateChunk::readBinary(prefix.data(), (int)prefix.size(), target), "prefix of " + juce::String((int)size));
+
+                if (size >= (size_t)StateChunk::headerSize)
+                {
+                    prefix[8] = (juce::uint8)(size & 0xff);
+                    prefix[9] = (juce::uint8)((size >> 8) & 0xff);
+                    prefix[10] = (juce::uint8)((size >> 16) & 0xff);
+                    prefix[11] = (juce::uint8)((size >> 24) & 0xff);
+
+                    target = makeReadTarget();
+                    expect(!StateChunk::readBinary(prefix.data(), (int)prefix.size(), target), "resized prefix of " + juce::String((int)size));
+                }
+            }
+        }
+
+        beginTest("A SimpleCC 1.0 XML state still loads");
+        {
+            auto xml = juce::parseXML("<SimpleCCState currentPresetManufacturer=\"Korg\" currentPresetName=\"MS-20\" isCurrentPresetUser=\"0\">"
+                                      "<Slot index=\"0\" cc=\"74\" channel=\"2\" enabled=\"1\" name=\"Cutoff\" value=\"0.5\"/>"
+                                      "<Slot index=\"3\" cc=\"71\" channel=\"16\" enabled=\"0\" name=\"Resonance\" value=\"1\"/>"
+                                      "</SimpleCCState>");
+            expect(xml != nullptr);
+
+            auto state = makeReadTarget();
+            state.slots[0].messageType = 3;
+            expect(xml != nullptr && StateChunk::readXml(*xml, state));
+
+            expectEquals(state.slots[0].ccNumber, 74);
+            expectEquals(state.slots[0].midiChannel, 2);
+            expect(state.slots[0].enabled);
+            expectEquals(state.slots[0].name, juce::String("Cutoff"));
+            expectEquals(state.slots[0].value, 0.5f);
+            expectEquals(state.slots[0].messageType, 0, "1.0 only sent control change");
+
+            expectEquals(state.slots[3].ccNumber, 71);
+            expectEquals(state.slots[3].midiChannel, 16);
+            expect(!state.slots[3].enabled);
+            expectEquals(state.slots[3].name, juce::String("Resonance"));
+            expectEquals(state.slots[3].value, 1.0f);
+
+            expectEquals(state.presetManufacturer, juce::String("Korg"));
+            expectEquals(state.presetName, juce::String("MS-20"));
+            expect(!state.presetIsUser);
+
+            // Everything 1.0 did not write reads back as its default.
+            expect(state.programs.empty());
+            expect(state.snapshots.empty());
+            expect(state.macros.empty());
+            expectEquals(state.lookaheadMs, 0);
+        }
+
+        beginTest("An XML state is not mistaken for a binary chunk");
+        {
+            auto xml = StateChunk::createXml(original);
+            auto text = xml->toString();
+            expect(!StateChunk::isBinary(text.toRawUTF8(), (int)text.getNumBytesAsUTF8()));
+
+            auto state = makeReadTarget();
+            expect(!StateChunk::readBinary(text.toRawUTF8(), (int)text.getNumBytesAsUTF8(), state));
+        }
+    }
+
+private:
+    void expectSlotsMatch(const std::vector<StateChunk::Slot>& actual, const std::vector<StateChunk::Slot>& expected)
+    {
+        expectEquals((int)actual.size(), (int)expected.size());
+
+        for (size_t i = 0; i < juce::jmin(actual.size(), expected.size()); ++i)
+        {
+            expectEquals(actual[i].ccNumber, expected[i].ccNumber);
+            expectEquals(actual[i].midiChannel, expected[i].midiChannel);
+            expect(actual[i].enabled == expected[i].enabled);
+            expectEquals(actual[i].messageType, expected[i].messageType);
+            expectEquals(actual[i].value, expected[i].value);
+            expectEquals(actual[i].name, expected[i].name);
+        }
+    }
+
+    void expectStatesMatch(const StateChunk::State& actual, const StateChunk::State& expected)
+    {
+        expectSlotsMatch(actual.slots, expected.slots);
+        expectEquals(actual.presetManufacturer, expected.presetManufacturer);
+        expectEquals(actual.presetName, expected.presetName);
+        expect(actual.presetIsUser == expected.presetIsUser);
+
+        expectEquals(actual.currentProgram, expected.currentProgram);
+        expectEquals(actual.programChangeChannel, expected.programChangeChannel);
+        expectEquals((int)actual.programs.size(), (int)expected.programs.size());
+
+        for (size_t p = 0; p < juce::jmin(actual.programs.size(), expected.programs.size()); ++p)
+        {
+            expectEquals(actual.programs[p].index, expected.programs[p].index);
+            expectEquals(actual.programs[p].name, expected.programs[p].name);
+            expectSlotsMatch(actual.programs[p].slots, expected.programs[p].slots);
+        }
+
+        expectEquals(actual.morphMode, expected.morphMode);
+        expectEquals(actual.morphX, expected.morphX);
+        expectEquals(actual.morphY, expected.morphY);
+        expect(actual.snapshots == expected.snapshots);
+
+        expectEquals((int)actual.macros.size(), (int)expected.macros.size());
+
+        for (size_t m = 0; m < juce::jmin(actual.macros.size(), expected.macros.size()); ++m)
+        {
+            const auto& a = actual.macros[m];
+            const auto& e = expected.macros[m];
+            expectEquals(a.value, e.value);
+            expectEquals((int)a.destinations.size(), (int)e.destinations.size());
+
+            for (size_t d = 0; d < juce::jmin(a.destinations.size(), e.destinations.size()); ++d)
+            {
+                expectEquals(a.destinations[d].ccNumber, e.destinations[d].ccNumber);
+                expectEquals(a.destinations[d].midiChannel, e.destinations[d].midiChannel);
+                expect(a.destinations[d].enabled == e.destinations[d].enabled);
+                expectEquals(a.destinations[d].curve, e.destinations[d].curve);
+                expectEquals(a.destinations[d].minValue, e.destinations[d].minValue);
+                expectEquals(a.destinations[d].maxValue, e.destinations[d].maxValue);
+            }
+        }
+
+        expectEquals(actual.mergePolicy, expected.mergePolicy);
+        expect(actual.refreshOnTransportStart == expected.refreshOnTransportStart);
+        expectEquals(actual.keepAliveSeconds, expected.keepAliveSeconds);
+        expectEquals(actual.lookaheadMs, expected.lookaheadMs);
+
+        expectEquals((int)actual.slotSources.size(), (int)expected.slotSources.size());
+
+        for (size_t i = 0; i < juce::jmin(actual.slotSources.size(), expected.slotSources.size()); ++i)
+        {
+            expectEquals(actual.slotSources[i].type, expected.slotSources[i].type);
+            expectEquals(actual.slotSources[i].ccNumber, expected.slotSources[i].ccNumber);
+        }
+
+        expect(actual.slotGridDivisions == expected.slotGridDivisions);
+    }
+};
+
+static StateChunkTests stateChunkTests;
@@ -0,0 +1,220 @@
+#include <JuceHeader.h>
+#include "InstrumentPresets.h"
+#include "PluginProcessor.h"
+#include "SysExDump.h"
+
+namespace
+{
+    std::vector<juce::uint8> getBytes(const SysExDump& dump)
+    {
+        return { dump.getData(), dump.getData() + dump.getSize() };
+    }
+
+    const InstrumentPreset* findPreset(const juce::String& manufacturer, const juce::String& name)
+    {
+        for (const auto& preset : getInstrumentPresets())
+            if (preset.manufacturer == manufacturer && preset.name == name)
+                return &preset;
+
+        return nullptr;
+    }
+}
+
+class SysExDumpTests : public juce::UnitTest
+{
+public:
+    SysExDumpTests() : juce::UnitTest("SysEx dump", "SimpleCC") {}
+
+    void runTest() override
+    {
+        beginTest("Two's complement checksum matches Roland's GS reset");
+        {
+            // F0 41 10 42 12 40 00 7F 00 41 F7, as given in Roland's GS documentation.
+            SysExTemplate gsReset;
+            gsReset.bytes = { 0xf0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7f, 0x00, 0x00, 0xf7 };
+            gsReset.checksum = checksumTwosComplement;
+            gsReset.checksumStart = 5;
+            gsReset.checksumEnd = 9;
+            gsReset.checksumOffset = 9;
+
+            SysExDump dump;
+            expect(dump.render(gsReset, 16));
+            expect(getBytes(dump) == std::vector<juce::uint8> { 0xf0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7f, 0x00, 0x41, 0xf7 });
+            expectEquals((int)dump.getSlotMask(), 0);
+        }
+
+        beginTest("Slot values and checksum are patched in place");
+        {
+            // GS "use for rhythm part" on part 1: F0 41 10 42 12 40 11 15 02 18 F7.
+            SysExTemplate rhythmPart;
+            rhythmPart.bytes = { 0xf0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x11, 0x15, 0x00, 0x00, 0xf7 };
+            rhythmPart.slotValues = { {}, { 8, SlotMessage::controlChange, 1, 0, 0, 2 } };
+            rhythmPart.checksum = checksumTwosComplement;
+            rhythmPart.checksumStart = 5;
+            rhythmPart.checksumEnd = 9;
+            rhythmPart.checksumOffset = 9;
+
+            SysExDump dump;
+            expect(dump.render(rhythmPart, 16));
+            expectEquals((int)dump.getSlotMask(), 0x02);
+
+            auto* before = dump.getData();
+            dump.setSlotValue(0, 0.5f);
+            dump.setSlotValue(1, 1.0f);
+            dump.updateChecksum();
+
+            expect(dump.getData() == before, "patching must not reallocate");
+            expect(getBytes(dump) == std::vector<juce::uint8> { 0xf0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x11, 0x15, 0x02, 0x18, 0xf7 });
+        }
+
+        beginTest("Masked sum checksum");
+        {
+            SysExTemplate summed;
+            summed.bytes = { 0xf0, 0x7d, 0x60, 0x70, 0x00, 0xf7 };
+            summed.checksum = checksumSum;
+            summed.checksumStart = 1;
+            summed.checksumEnd = 4;
+            summed.checksumOffset = 4;
+
+            SysExDump dump;
+            expect(dump.render(summed, 16));
+            expectEquals((int)dump.getData()[4], (0x7d + 0x60 + 0x70) & 0x7f);
+        }
+
+        beginTest("Malformed templates are refused");
+        {
+            SysExDump dump;
+            SysExTemplate noEnd;
+            noEnd.bytes = { 0xf0, 0x41, 0x10 };
+            expect(!dump.render(noEnd, 16));
+            expect(dump.isEmpty());
+
+            SysExTemplate highBit;
+            highBit.bytes = { 0xf0, 0x41, 0x90, 0xf7 };
+            expect(!dump.render(highBit, 16));
+
+            SysExTemplate valueOnStatus;
+            valueOnStatus.bytes = { 0xf0, 0x41, 0x00, 0xf7 };
+            valueOnStatus.slotValues = { { 0 } };
+            expect(!dump.render(valueOnStatus, 16));
+
+            SysExTemplate invertedRange;
+            invertedRange.bytes = { 0xf0, 0x41, 0x00, 0xf7 };
+            invertedRange.slotValues = { { 2, SlotMessage::controlChange, 1, 7, 0x72, 0x0e } };
+            expect(!dump.render(invertedRange, 16));
+
+            SysExTemplate checksumInsideRange;
+            checksumInsideRange.bytes = { 0xf0, 0x41, 0x00, 0x00, 0xf7 };
+            checksumInsideRange.checksum = checksumTwosComplement;
+            checksumInsideRange.checksumStart = 1;
+            checksumInsideRange.checksumEnd = 4;
+            checksumInsideRange.checksumOffset = 3;
+            expect(!dump.render(checksumInsideRange, 16));
+        }
+
+        beginTest("Sound Canvas preset renders a GS tone modify dump");
+        {
+            auto* preset = findPreset("Roland", "Roland Sound Canvas");
+            expect(preset != nullptr);
+
+            if (preset == nullptr)
+                return;
+
+            SysExDump dump;
+            expect(dump.render(preset->sysex, 16));
+            expectEquals((int)dump.getSlotMask(), 0xff);
+
+            // Every value at centre: 40 11 30 plus 8 x 40 sums to 641, and
+            // 128 - 641 % 128 = 0x7f.
+            expect(getBytes(dump) == std::vector<juce::uint8> { 0xf0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x11, 0x30,
+                                                                0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+                                                                0x7f, 0xf7 });
+
+            // Slots follow the preset's mappings: cutoff is slot 1 and lands
+            // on 40 11 32, vibrato rate is slot 6 and lands on 40 11 30. The
+            // full slot range spans the GS range, 0E to 72.
+            dump.setSlotValue(0, 1.0f);
+            dump.setSlotValue(5, 0.0f);
+            dump.updateChecksum();
+
+            expect(getBytes(dump) == std::vector<juce::uint8> { 0xf0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x11, 0x30,
+                                                                0x0e, 0x40, 0x72, 0x40, 0x40, 0x40, 0x40, 0x40,
+                                                                0x7f, 0xf7 });
+
+            dump.setSlotValue(1, 0.51f);
+            dump.updateChecksum();
+            expectEquals((int)dump.getData()[11], 0x41);
+            expectEquals((int)dump.getData()[16], 0x7e);
+
+            dump.resetSlotValue(0);
+            expectEquals((int)dump.getData()[10], 0x40);
+
+            expectEquals(dump.getSlotDestinationKey(0), SlotMessage::getDestinationKey(SlotMessage::controlChange, 1, 74));
+        }
+
+        beginTest("A slot moved off its dump byte is sent on its own");
+        {
+            auto* preset = findPreset("Roland", "Roland Sound Canvas");
+
+            if (preset == nullptr)
+                return;
+
+            SimpleCCProcessor processor;
+            processor.setPlayConfigDetails(0, 0, 48000.0, 512);
+
+            {
+                SimpleCCProcessor::ScopedSlotUpdate update(processor);
+                processor.loadDefaultPreset(preset->manufacturer, preset->name);
+
+                for (int i = 0; i < NUM_SLOTS; ++i)
+                {
+                    bool mapped = i < (int)preset->mappings.size();
+                    processor.setSlotEnabled(i, mapped);
+                    processor.setSlotMessageType(i, SlotMessage::controlChange);
+                    processor.setSlotMidiChannel(i, 1);
+                    processor.setSlotCCNumber(i, mapped ? preset->mappings[(size_t)i].ccNumber : -1);
+                    processor.setSlotValue(i, 0.5f);
+                }
+
+                // Cutoff becomes pan; the preset name stays the same.
+                processor.setSlotCCNumber(0, 10);
+                processor.setSlotValue(0, 1.0f);
+            }
+
+            processor.prepareToPlay(48000.0, 512);
+
+            juce::AudioBuffer<float> buffer(0, 512);
+            juce::MidiBuffer midi;
+            processor.processBlock(buffer, midi);
+
+            std::vector<juce::uint8> sysex;
+            std::vector<int> controllers;
+
+            for (const auto metadata : midi)
+            {
+                if (metadata.data[0] == 0xf0)
+                    sysex.assign(metadata.data, metadata.data + metadata.numBytes);
+                else if ((metadata.data[0] & 0xf0) == 0xb0)
+                    controllers.push_back(metadata.data[1]);
+            }
+
+            expectEquals((int)sysex.size(), 18);
+
+            if (sysex.size() == 18)
+            {
+                expectEquals((int)sysex[10], 0x40, "the cutoff byte keeps its default");
+                expectEquals((int)sysex[11], 0x40);
+            }
+
+            expect(controllers == std::vector<int> { 10 }, "only pan goes out as a controller");
+
+            // The capture keeps the dump itself, not just its length.
+            auto captured = processor.getOutputCapture().getEvents(48000);
+            auto dump = std::find_if(captured.begin(), captured.end(), [] (const auto& event) { return event.size > 3; });
+
+            expect(dump != captured.end() && dump->sysex == sysex, "the captured dump carries its bytes");
+        }
+    }
+};
+
+static SysExDumpTests sysExDumpTests;
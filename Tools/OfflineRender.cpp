@@ -0,0 +1,440 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+
+// Renders a session offline through SimpleCCProcessor and writes what it
+// sends to a Standard MIDI File.
+//
+// A session is a JSON object:
+//
+//   {
+//     "sampleRate": 48000,          optional, default 48000
+//     "blockSize": 512,             optional, default 512
+//     "controlInterval": 32,        optional, samples between automation reads in verify
+//     "length": 8.0,                optional, seconds; default is the last point
+//     "slots": [
+//       { "slot": 1, "type": "CC", "number": 74, "channel": 1, "name": "Cutoff",
+//         "automation": [ [0.0, 0.0], [4.0, 1.0], [8.0, 0.25] ] }
+//     ]
+//   }
+//
+// "type" is one of the slot message names shown in the editor (CC, Bend,
+// Pressure, Poly AT, Program, CC 14-bit). Automation points are (seconds, normalized
+// value) pairs, interpolated linearly and held past either end.
+//
+// render behaves like a host: one processBlock call per host block, with each
+// slot's automation read at the start of the block. The processor takes one
+// value per parameter per block, so where a change lands depends on the
+// block size; --golden compares the result byte for byte against a file
+// rendered at the session's own block size.
+//
+// verify instead reads automation every controlInterval samples of absolute
+// time and splits the host blocks there, so the values the processor sees
+// never depend on the block size, and checks that the output does not
+// either: the same session rendered at every block size must produce the
+// same messages at the same sample times. Only that chunked path is checked
+// for block size independence.
+
+namespace
+{
+    constexpr int blockSizesToVerify[] = { 16, 32, 64, 100, 128, 256, 441, 512, 1024, 4096 };
+
+    struct AutomationPoint
+    {
+        double seconds = 0.0;
+        float value = 0.0f;
+    };
+
+    struct SessionSlot
+    {
+        int slot = 0;
+        int messageType = SlotMessage::controlChange;
+        int number = 0;
+        int channel = 1;
+        juce::String name;
+        std::vector<AutomationPoint> automation;
+    };
+
+    struct Session
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int controlInterval = 32;
+        double lengthSeconds = 0.0;
+        std::vector<SessionSlot> slots;
+    };
+
+    juce::File getFile(const juce::String& path)
+    {
+        return juce::File::getCurrentWorkingDirectory().getChildFile(path);
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage:\n"
+                  << "  SimpleCCRender render <session.json> <output.mid> [--sample-rate N] [--block-size N] [--golden <expected.mid>]\n"
+                  << "  SimpleCCRender verify <session.json>\n";
+    }
+
+    int parseMessageType(const juce::String& name)
+    {
+        for (int type = 0; type < SlotMessage::numTypes; ++type)
+            if (name.equalsIgnoreCase(SlotMessage::encodings[type].name))
+                return type;
+
+        return -1;
+    }
+
+    bool parseSession(const juce::File& file, Session& session, juce::String& error)
+    {
+        juce::var json;
+        auto result = juce::JSON::parse(file.loadFileAsString(), json);
+
+        if (result.failed() || !json.isObject())
+        {
+            error = "Not a JSON session: " + result.getErrorMessage();
+            return false;
+        }
+
+        session.sampleRate = (double)json.getProperty("sampleRate", session.sampleRate);
+        session.blockSize = (int)json.getProperty("blockSize", session.blockSize);
+        session.controlInterval = (int)json.getProperty("controlInterval", session.controlInterval);
+        session.lengthSeconds = (double)json.getProperty("length", 0.0);
+
+        if (session.sampleRate <= 0.0 || session.blockSize <= 0 || session.controlInterval <= 0)
+        {
+            error = "sampleRate, blockSize and controlInterval must be positive";
+            return false;
+        }
+
+        auto* slots = json.getProperty("slots", {}).getArray();
+
+        if (slots == nullptr || slots->isEmpty() || slots->size() > NUM_SLOTS)
+        {
+            error = "slots must list between 1 and " + juce::String(NUM_SLOTS) + " slots";
+            return false;
+        }
+
+        double lastPoint = 0.0;
+
+        for (int i = 0; i < slots->size(); ++i)
+        {
+            const auto& slotJson = slots->getReference(i);
+            SessionSlot slot;
+            slot.slot = (int)slotJson.getProperty("slot", i + 1) - 1;
+            slot.messageType = parseMessageType(slotJson.getProperty("type", "CC").toString());
+            slot.number = (int)slotJson.getProperty("number", 0);
+            slot.channel = (int)slotJson.getProperty("channel", 1);
+            slot.name = slotJson.getProperty("name", "Slot " + juce::String(slot.slot + 1)).toString();
+
+            if (slot.slot < 0 || slot.slot >= NUM_SLOTS || slot.messageType < 0
+                || slot.number < 0 || slot.number > 127 || slot.channel < 1 || slot.channel > 16)
+            {
+                error = "Invalid slot entry " + juce::String(i + 1);
+                return false;
+            }
+
+            if (auto* points = slotJson.getProperty("automation", {}).getArray())
+            {
+                for (const auto& pointJson : *points)
+                {
+                    if (!pointJson.isArray() || pointJson.size() != 2)
+                    {
+                        error = "Automation points of slot entry " + juce::String(i + 1) + " must be [seconds, value] pairs";
+                        return false;
+                    }
+
+                    AutomationPoint point;
+                    point.seconds = (double)pointJson[0];
+                    point.value = juce::jlimit(0.0f, 1.0f, (float)pointJson[1]);
+
+                    if (!slot.automation.empty() && point.seconds < slot.automation.back().seconds)
+                    {
+                        error = "Automation points of slot entry " + juce::String(i + 1) + " are not in time order";
+                        return false;
+                    }
+
+                    slot.automation.push_back(point);
+                    lastPoint = juce::jmax(lastPoint, point.seconds);
+                }
+            }
+
+            session.slots.push_back(slot);
+        }
+
+        if (session.lengthSeconds <= 0.0)
+            session.lengthSeconds = lastPoint;
+
+        if (session.lengthSeconds <= 0.0)
+        {
+            error = "The session has no length";
+            return false;
+        }
+
+        return true;
+    }
+
+    float evaluateAutomation(const std::vector<AutomationPoint>& automation, double seconds)
+    {
+        if (automation.empty())
+            return 0.0f;
+
+        if (seconds <= automation.front().seconds)
+            return automation.front().value;
+
+        for (size_t i = 1; i < automation.size(); ++i)
+        {
+            const auto& next = automation[i];
+
+            if (seconds < next.seconds)
+            {
+                const auto& previous = automation[i - 1];
+                auto position = (seconds - previous.seconds) / (next.seconds - previous.seconds);
+                return previous.value + (float)position * (next.value - previous.value);
+            }
+        }
+
+        return automation.back().value;
+    }
+
+    // The track a message goes to is the slot whose destination it was sent
+    // to; when slots share a destination the first one gets it. Both halves
+    // of a 14-bit controller go to its slot.
+    int findSlot(const std::map<int, int>& slotsByDestination, const juce::uint8* data, int size)
+    {
+        if (size < 1 || size > 3)
+            return OutputCapture::noSlot;
+
+        for (int type = 0; type < SlotMessage::numTypes; ++type)
+        {
+            if ((data[0] & 0xf0) != SlotMessage::encodings[type].status)
+                continue;
+
+            int number = SlotMessage::usesNumber(type) && size > 1 ? data[1] : 0;
+
+            if (type == SlotMessage::controlChange14 && number >= 64)
+                continue;
+
+            auto found = slotsByDestination.find(SlotMessage::getDestinationKey(type, (data[0] & 0x0f) + 1, number));
+
+            if (found != slotsByDestination.end())
+                return found->second;
+        }
+
+        return OutputCapture::noSlot;
+    }
+
+    enum class AutomationReads
+    {
+        perHostBlock,
+        perControlInterval
+    };
+
+    std::vector<OutputCapture::Event> renderSession(const Session& session, int blockSize, AutomationReads reads)
+    {
+        SimpleCCProcessor processor;
+        processor.setPlayConfigDetails(0, 0, session.sampleRate, blockSize);
+
+        std::map<int, int> slotsByDestination;
+
+        {
+            SimpleCCProcessor::ScopedSlotUpdate update(processor);
+
+            for (int i = 0; i < NUM_SLOTS; ++i)
+                processor.setSlotEnabled(i, false);
+
+            for (const auto& slot : session.slots)
+            {
+                processor.setSlotMessageType(slot.slot, slot.messageType);
+                processor.setSlotCCNumber(slot.slot, slot.number);
+                processor.setSlotMidiChannel(slot.slot, slot.channel);
+                processor.updateSlotName(slot.slot, slot.name);
+                processor.setSlotEnabled(slot.slot, true);
+                processor.setSlotValue(slot.slot, evaluateAutomation(slot.automation, 0.0));
+
+                slotsByDestination.insert({ SlotMessage::getDestinationKey(slot.messageType, slot.channel, slot.number), slot.slot });
+            }
+        }
+
+        processor.prepareToPlay(session.sampleRate, blockSize);
+
+        auto totalSamples = (juce::int64)std::ceil(session.lengthSeconds * session.sampleRate);
+        // Reading once per host block makes each block a single chunk.
+        auto interval = reads == AutomationReads::perControlInterval ? (juce::int64)session.controlInterval
+                                                                     : (juce::int64)blockSize;
+
+        juce::AudioBuffer<float> buffer(0, blockSize);
+        juce::MidiBuffer midi;
+        std::vector<OutputCapture::Event> events;
+
+        for (juce::int64 blockStart = 0; blockStart < totalSamples; blockStart += blockSize)
+        {
+            auto blockEnd = juce::jmin(blockStart + blockSize, totalSamples);
+
+            for (auto chunkStart = blockStart; chunkStart < blockEnd;)
+            {
+                auto chunkEnd = juce::jmin(blockEnd, (chunkStart / interval + 1) * interval);
+
+                if (chunkStart % interval == 0)
+                    for (const auto& slot : session.slots)
+                        processor.setSlotValue(slot.slot, evaluateAutomation(slot.automation, (double)chunkStart / session.sampleRate));
+
+                buffer.setSize(0, (int)(chunkEnd - chunkStart), false, false, true);
+                midi.clear();
+                processor.processBlock(buffer, midi);
+
+                for (const auto metadata : midi)
+                {
+                    OutputCapture::Event event;
+                    event.time = chunkStart + metadata.samplePosition;
+                    event.slot = findSlot(slotsByDestination, metadata.data, metadata.numBytes);
+                    event.size = metadata.numBytes;
+                    std::copy(metadata.data, metadata.data + juce::jmin(3, metadata.numBytes), event.bytes);
+
+                    if (metadata.numBytes > 3)
+                        event.sysex.assign(metadata.data, metadata.data + metadata.numBytes);
+
+                    events.push_back(event);
+                }
+
+                chunkStart = chunkEnd;
+            }
+        }
+
+        processor.releaseResources();
+        return events;
+    }
+
+    bool isSameEvent(const OutputCapture::Event& a, const OutputCapture::Event& b)
+    {
+        return a.time == b.time && a.size == b.size && std::equal(a.bytes, a.bytes + 3, b.bytes);
+    }
+
+    juce::String describe(const OutputCapture::Event& event)
+    {
+        return "sample " + juce::String(event.time) + ": "
+             + juce::String::toHexString(event.bytes, juce::jmin(3, event.size));
+    }
+
+    int renderToFile(const juce::File& sessionFile, const juce::File& outputFile,
+                     double sampleRate, int blockSize, const juce::File& goldenFile)
+    {
+        Session session;
+        juce::String error;
+
+        if (!parseSession(sessionFile, session, error))
+        {
+            std::cerr << sessionFile.getFullPathName() << ": " << error << "\n";
+            return 1;
+        }
+
+        if (sampleRate > 0.0)
+            session.sampleRate = sampleRate;
+
+        if (blockSize > 0)
+            session.blockSize = blockSize;
+
+        auto start = std::chrono::steady_clock::now();
+        auto events = renderSession(session, session.blockSize, AutomationReads::perHostBlock);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (!OutputCapture::writeMidiFile(events, session.sampleRate, 0, outputFile))
+        {
+            std::cerr << "Failed to write " << outputFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        std::cout << "Rendered " << session.lengthSeconds << " s, " << events.size() << " messages to "
+                  << outputFile.getFullPathName() << " (" << juce::String(session.lengthSeconds / elapsed.count(), 1)
+                  << "x real time)\n";
+
+        if (goldenFile != juce::File() && !outputFile.hasIdenticalContentTo(goldenFile))
+        {
+            std::cerr << outputFile.getFullPathName() << " differs from " << goldenFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        return 0;
+    }
+
+    int verifyBlockSizes(const juce::File& sessionFile)
+    {
+        Session session;
+        juce::String error;
+
+        if (!parseSession(sessionFile, session, error))
+        {
+            std::cerr << sessionFile.getFullPathName() << ": " << error << "\n";
+            return 1;
+        }
+
+        auto reference = renderSession(session, session.blockSize, AutomationReads::perControlInterval);
+        int numFailed = 0;
+
+        for (int blockSize : blockSizesToVerify)
+        {
+            auto events = renderSession(session, blockSize, AutomationReads::perControlInterval);
+            auto mismatch = std::mismatch(reference.begin(), reference.end(), events.begin(), events.end(), isSameEvent);
+
+            if (mismatch.first == reference.end() && mismatch.second == events.end())
+            {
+                std::cout << "PASS  block size " << blockSize << ", " << events.size() << " messages\n";
+                continue;
+            }
+
+            ++numFailed;
+            std::cout << "FAIL  block size " << blockSize << " differs from block size " << session.blockSize
+                      << "\n      expected " << (mismatch.first != reference.end() ? describe(*mismatch.first) : juce::String("nothing"))
+                      << "\n      got      " << (mismatch.second != events.end() ? describe(*mismatch.second) : juce::String("nothing")) << "\n";
+        }
+
+        return numFailed == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::StringArray args(argv + 1, argc - 1);
+
+    double sampleRate = 0.0;
+    int blockSize = 0;
+    juce::File goldenFile;
+
+    int sampleRateArg = args.indexOf("--sample-rate");
+    if (sampleRateArg >= 0 && sampleRateArg + 1 < args.size())
+    {
+        sampleRate = args[sampleRateArg + 1].getDoubleValue();
+        args.removeRange(sampleRateArg, 2);
+    }
+
+    int blockSizeArg = args.indexOf("--block-size");
+    if (blockSizeArg >= 0 && blockSizeArg + 1 < args.size())
+    {
+        blockSize = juce::jlimit(1, 65536, args[blockSizeArg + 1].getIntValue());
+        args.removeRange(blockSizeArg, 2);
+    }
+
+    int goldenArg = args.indexOf("--golden");
+    if (goldenArg >= 0 && goldenArg + 1 < args.size())
+    {
+        goldenFile = getFile(args[goldenArg + 1]);
+        args.removeRange(goldenArg, 2);
+    }
+
+    // Never read the user's presets; the session describes everything.
+    SimpleCCProcessor::setPresetDirectoryOverride(juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                                      .getChildFile("SimpleCCRenderNoPresets"));
+
+    if (args.size() == 3 && args[0] == "render")
+        return renderToFile(getFile(args[1]), getFile(args[2]), sampleRate, blockSize, goldenFile);
+
+    if (args.size() == 2 && args[0] == "verify")
+        return verifyBlockSizes(getFile(args[1]));
+
+    printUsage();
+    return 1;
+}
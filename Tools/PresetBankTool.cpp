@@ -0,0 +1,124 @@
+#include <JuceHeader.h>
+#include "PresetBank.h"
+
+#include <iostream>
+
+namespace
+{
+    constexpr int defaultSlotsPerPreset = 16;
+
+    juce::String makeSafeFilename(const juce::String& manufacturer, const juce::String& name)
+    {
+        return (manufacturer + "_" + name).replaceCharacter(' ', '_')
+            .replaceCharacter('/', '_').replaceCharacter('\\', '_')
+            .replaceCharacter(':', '_').replaceCharacter('*', '_')
+            .replaceCharacter('?', '_').replaceCharacter('"', '_')
+            .replaceCharacter('<', '_').replaceCharacter('>', '_')
+            .replaceCharacter('|', '_') + ".xml";
+    }
+
+    juce::File getFile(const juce::String& path)
+    {
+        return juce::File::getCurrentWorkingDirectory().getChildFile(path);
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage:\n"
+                  << "  SimpleCCPresetBank import <preset-xml-dir> <bank-file> [--slots N]\n"
+                  << "  SimpleCCPresetBank export <bank-file> <output-dir>\n"
+                  << "  SimpleCCPresetBank list <bank-file>\n";
+    }
+
+    int importPresets(const juce::File& sourceDir, const juce::File& bankFile, int slotsPerPreset)
+    {
+        if (!sourceDir.isDirectory())
+        {
+            std::cerr << "Not a directory: " << sourceDir.getFullPathName() << "\n";
+            return 1;
+        }
+
+        PresetBankBuilder builder(slotsPerPreset);
+        int numAdded = builder.addPresetXmlDirectory(sourceDir);
+
+        if (!builder.writeToFile(bankFile))
+        {
+            std::cerr << "Failed to write " << bankFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        std::cout << "Imported " << numAdded << " presets into " << bankFile.getFullPathName() << "\n";
+        return 0;
+    }
+
+    int exportPresets(const juce::File& bankFile, const juce::File& targetDir)
+    {
+        PresetBank bank(bankFile);
+        if (!bank.isValid())
+        {
+            std::cerr << "Not a valid preset bank: " << bankFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        if (targetDir.createDirectory().failed())
+        {
+            std::cerr << "Cannot create " << targetDir.getFullPathName() << "\n";
+            return 1;
+        }
+
+        int numWritten = 0;
+        for (int i = 0; i < bank.getNumPresets(); ++i)
+        {
+            auto xml = bank.createPresetXml(i);
+            auto presetFile = targetDir.getChildFile(makeSafeFilename(bank.getManufacturer(i), bank.getName(i)));
+
+            if (presetFile.replaceWithText(xml->toString()))
+                ++numWritten;
+            else
+                std::cerr << "Failed to write " << presetFile.getFullPathName() << "\n";
+        }
+
+        std::cout << "Exported " << numWritten << " presets to " << targetDir.getFullPathName() << "\n";
+        return numWritten == bank.getNumPresets() ? 0 : 1;
+    }
+
+    int listPresets(const juce::File& bankFile)
+    {
+        PresetBank bank(bankFile);
+        if (!bank.isValid())
+        {
+            std::cerr << "Not a valid preset bank: " << bankFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        for (int i = 0; i < bank.getNumPresets(); ++i)
+            std::cout << bank.getManufacturerUTF8(i) << " - " << bank.getNameUTF8(i) << "\n";
+
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray args(argv + 1, argc - 1);
+
+    int slotsPerPreset = defaultSlotsPerPreset;
+    int slotsArg = args.indexOf("--slots");
+    if (slotsArg >= 0 && slotsArg + 1 < args.size())
+    {
+        slotsPerPreset = juce::jlimit(1, 0xffff, args[slotsArg + 1].getIntValue());
+        args.removeRange(slotsArg, 2);
+    }
+
+    if (args.size() == 3 && args[0] == "import")
+        return importPresets(getFile(args[1]), getFile(args[2]), slotsPerPreset);
+
+    if (args.size() == 3 && args[0] == "export")
+        return exportPresets(getFile(args[1]), getFile(args[2]));
+
+    if (args.size() == 2 && args[0] == "list")
+        return listPresets(getFile(args[1]));
+
+    printUsage();
+    return 1;
+}